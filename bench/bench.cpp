@@ -0,0 +1,115 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ *
+ * Benchmarks of the HobrasoftHttpd library
+ *
+ * Usage: hobrasofthttpd-bench [benchmark...]
+ *
+ * All benchmarks are run when no name is given. Build the benchmarks
+ * in Release mode, results of Debug builds are not meaningful.
+ */
+
+#include "bench.h"
+#include <QCoreApplication>
+#include <QStringList>
+#include <stdio.h>
+#include <time.h>
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#endif
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#ifdef Q_OS_LINUX
+pthread_t mainThread;
+#endif
+
+struct Benchmark {
+    const char *name;
+    void      (*run)();
+};
+
+const Benchmark benchmarks[] = {
+    { "gzip",           benchGzip },
+    { "crc32",          benchCrc32 },
+    { "large-body",     benchLargeBody },
+    { "latency",        benchLatency },
+    { "requests",       benchRequests },
+    { "slow-clients",   benchSlowClients },
+    { "allocations",    benchAllocations },
+};
+#endif
+
+}
+
+
+void report(const char *name, double value, const char *unit) {
+    printf("%-48s %14.2f %s\n", name, value, unit);
+    fflush(stdout);
+}
+
+
+void reportFailure(const char *name) {
+    printf("%-48s %14s\n", name, "failed");
+    fflush(stdout);
+}
+
+
+double serverCpuTime() {
+    #ifdef Q_OS_LINUX
+    clockid_t cpuClock;
+    struct timespec cpuTime;
+    if (pthread_getcpuclockid(mainThread, &cpuClock) == 0 && clock_gettime(cpuClock, &cpuTime) == 0) {
+        return cpuTime.tv_sec + cpuTime.tv_nsec / 1e9;
+        }
+    #endif
+    return double(::clock()) / CLOCKS_PER_SEC;
+}
+
+
+QByteArray sample(int size) {
+    static const char words[] = "lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor ";
+    QByteArray data;
+    data.reserve(size + 16);
+    quint32 seed = 12345;
+    while (data.size() < size) {
+        seed = seed * 1103515245u + 12345u;
+        int offset = (seed >> 16) % (sizeof(words) - 1);
+        data.append(words + offset, qMin(int(sizeof(words) - 1) - offset, 1 + int(seed >> 28)));
+        data.append(char(seed >> 8));
+        }
+    data.truncate(size);
+    return data;
+}
+
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    #ifdef Q_OS_LINUX
+    mainThread = pthread_self();
+    #endif
+    countAllocations();
+    QStringList names = app.arguments().mid(1);
+
+    int count = int(sizeof(benchmarks) / sizeof(benchmarks[0]));
+    for (int i=0; i<names.size(); i++) {
+        bool found = false;
+        for (int b=0; b<count; b++) {
+            found = found || names[i] == benchmarks[b].name;
+            }
+        if (!found) {
+            fprintf(stderr, "Unknown benchmark: %s\n", qPrintable(names[i]));
+            return 1;
+            }
+        }
+
+    for (int b=0; b<count; b++) {
+        if (names.isEmpty() || names.contains(benchmarks[b].name)) {
+            benchmarks[b].run();
+            }
+        }
+    return 0;
+}
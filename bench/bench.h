@@ -0,0 +1,59 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+#ifndef _Bench_H_
+#define _Bench_H_
+
+#include <QByteArray>
+
+/**
+ * @brief Prints one measured value of a benchmark
+ */
+void report(const char *name, double value, const char *unit);
+
+/**
+ * @brief Prints that a benchmark could not be measured
+ */
+void reportFailure(const char *name);
+
+/**
+ * @brief Returns CPU time of the main thread running the server in seconds
+ *
+ * CPU time of the whole process is returned on systems other than Linux.
+ */
+double serverCpuTime();
+
+/**
+ * @brief Returns number of memory allocations made by the main thread running the server
+ *
+ * Calls of malloc(), calloc() and realloc() are counted, operator new and Qt containers use them.
+ * Allocations are counted with glibc only, -1 is returned elsewhere.
+ */
+qint64 serverAllocations();
+
+/**
+ * @brief Starts counting of allocations in the current thread, called from main()
+ */
+void countAllocations();
+
+/**
+ * @brief Returns reproducible data resembling a text with some binary bytes
+ */
+QByteArray sample(int size);
+
+/**
+ * @brief Minimal duration of a measurement in milliseconds
+ */
+#define BENCH_DURATION 1000
+
+void benchGzip();
+void benchCrc32();
+void benchLargeBody();
+void benchLatency();
+void benchRequests();
+void benchSlowClients();
+void benchAllocations();
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ *
+ * Memory allocations per request
+ *
+ * With glibc the allocation functions of the benchmark executable replace
+ * the functions of the C library for the whole process, Qt libraries included.
+ * They count calls made from the thread of the server and pass them to glibc.
+ */
+
+#include "bench.h"
+#include "bench_server.h"
+#include "bench_client.h"
+#include <stdlib.h>
+#include <atomic>
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+thread_local bool counting = false;
+std::atomic<qint64> allocations(0);
+
+inline void countAllocation() {
+    if (counting) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+}
+#endif
+
+}
+
+
+#if defined(__GLIBC__) && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) __THROW {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+
+void *calloc(size_t count, size_t size) __THROW {
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+
+void *realloc(void *ptr, size_t size) __THROW {
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+}
+#endif
+
+
+void countAllocations() {
+    counting = true;
+}
+
+
+qint64 serverAllocations() {
+    #ifdef __GLIBC__
+    return allocations.load(std::memory_order_relaxed);
+    #else
+    return -1;
+    #endif
+}
+
+
+void benchAllocations() {
+    if (serverAllocations() < 0) {
+        reportFailure("allocations are counted with glibc only");
+        return;
+        }
+
+    BenchServer server;
+    server.start();
+
+    // Keep-alive connection, pipelined requests, new connection for each request
+    const int warmup = 112;
+    const int count = 2000;     // both divisible by the pipeline depth
+    const char *names[] = {
+        "allocations per request, keep-alive",
+        "allocations per request, pipeline depth 16",
+        "allocations per request, new connection",
+        };
+    for (int mode=0; mode<3; mode++) {
+        int depth = (mode == 1) ? 16 : 1;
+        QByteArray request = BenchClient::browserRequest("/100", (mode == 2) ? "Connection: close\r\n" : "");
+        QByteArray batch = request.repeated(depth);
+        qint64 allocated = 0;
+        qint64 requests = 0;
+        bool ok = false;
+
+        runClient([&]() {
+            BenchClient *client = NULL;
+            qint64 allocations0 = 0;
+            for (int i=0; i<warmup + count; i += depth) {
+                if (i == warmup) {
+                    allocations0 = serverAllocations();
+                    }
+                if (client == NULL || mode == 2) {
+                    delete client;
+                    client = new BenchClient();
+                    if (!client->connectToServer(server.port())) {
+                        break;
+                        }
+                    }
+                if (!client->send(batch)) {
+                    break;
+                    }
+                int r = 0;
+                while (r < depth && client->readResponse() == 200) {
+                    r++;
+                    }
+                if (r < depth) {
+                    break;
+                    }
+                if (i >= warmup) {
+                    requests += depth;
+                    }
+                }
+            allocated = serverAllocations() - allocations0;
+            ok = (requests == count);
+            delete client;
+            });
+
+        if (!ok) {
+            reportFailure(names[mode]);
+            continue;
+            }
+        report(names[mode], double(allocated) / requests, "");
+        }
+}
@@ -0,0 +1,180 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "bench_client.h"
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QThread>
+#include <QEventLoop>
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+class ClientThread : public QThread {
+  public:
+    ClientThread(const std::function<void()>& client) : m_client(client) {}
+  protected:
+    void run() { m_client(); }
+  private:
+    std::function<void()> m_client;
+};
+#endif
+
+}
+
+
+void runClient(const std::function<void()>& client) {
+    runClients(QList<std::function<void()> >() << client);
+}
+
+
+void runClients(const QList<std::function<void()> >& clients) {
+    QEventLoop loop;
+    QList<ClientThread *> threads;
+    for (int i=0; i<clients.size(); i++) {
+        ClientThread *thread = new ClientThread(clients[i]);
+        QObject::connect(thread, SIGNAL(finished()), &loop, SLOT(quit()));
+        threads << thread;
+        thread->start();
+        }
+
+    // Every finished thread quits the loop once, the loop is started again while any thread runs
+    while (true) {
+        bool running = false;
+        for (int i=0; i<threads.size(); i++) {
+            running = running || !threads[i]->isFinished();
+            }
+        if (!running) {
+            break;
+            }
+        loop.exec();
+        }
+
+    for (int i=0; i<threads.size(); i++) {
+        threads[i]->wait();
+        }
+    qDeleteAll(threads);
+}
+
+
+BenchClient::~BenchClient() {
+    delete m_socket;
+}
+
+
+BenchClient::BenchClient() {
+    m_socket = new QTcpSocket();
+    m_throttleSize = 0;
+    m_throttlePause = 0;
+}
+
+
+bool BenchClient::connectToServer(int port) {
+    m_socket->connectToHost(QHostAddress::LocalHost, port);
+    return m_socket->waitForConnected(BENCH_CLIENT_TIMEOUT);
+}
+
+
+void BenchClient::setThrottle(int size, int pause) {
+    m_throttleSize = size;
+    m_throttlePause = pause;
+    m_socket->setReadBufferSize(size);
+    m_socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, size);
+}
+
+
+bool BenchClient::isConnected() {
+    if (m_socket->state() == QAbstractSocket::ConnectedState && m_socket->waitForReadyRead(0)) {
+        m_buffer += m_socket->readAll();
+        }
+    return m_socket->state() == QAbstractSocket::ConnectedState;
+}
+
+
+bool BenchClient::send(const QByteArray& data) {
+    if (m_socket->write(data) != data.size()) {
+        return false;
+        }
+    while (m_socket->bytesToWrite() > 0) {
+        if (!m_socket->waitForBytesWritten(BENCH_CLIENT_TIMEOUT)) {
+            return false;
+            }
+        }
+    return true;
+}
+
+
+/**
+ * @brief Appends data received from the socket to the buffer, waits for them if needed
+ */
+bool BenchClient::fill() {
+    if (m_socket->bytesAvailable() == 0 && !m_socket->waitForReadyRead(BENCH_CLIENT_TIMEOUT)) {
+        return false;
+        }
+
+    if (m_throttleSize <= 0) {
+        m_buffer += m_socket->readAll();
+        return true;
+        }
+
+    m_buffer += m_socket->read(m_throttleSize);
+    QThread::msleep(m_throttlePause);
+    return true;
+}
+
+
+int BenchClient::readResponse(qint64 *bodySize) {
+    int end;
+    while ((end = m_buffer.indexOf("\r\n\r\n")) < 0) {
+        if (!fill()) {
+            return -1;
+            }
+        }
+
+    // Status line HTTP/1.1 200 OK
+    QList<QByteArray> lines = m_buffer.left(end).split('\n');
+    m_buffer.remove(0, end + 4);
+    int status = lines[0].mid(9, 3).toInt();
+    qint64 length = 0;
+    for (int i=1; i<lines.size(); i++) {
+        if (lines[i].toLower().startsWith("content-length:")) {
+            length = lines[i].mid(15).trimmed().toLongLong();
+            }
+        }
+
+    qint64 remaining = length;
+    while (remaining > 0) {
+        if (m_buffer.isEmpty() && !fill()) {
+            return -1;
+            }
+        int size = int(qMin(remaining, qint64(m_buffer.size())));
+        m_buffer.remove(0, size);
+        remaining -= size;
+        }
+
+    if (bodySize != NULL) {
+        *bodySize = length;
+        }
+    return status;
+}
+
+
+QByteArray BenchClient::request(const QByteArray& path, const QByteArray& headers) {
+    return "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n";
+}
+
+
+QByteArray BenchClient::browserRequest(const QByteArray& path, const QByteArray& headers) {
+    return request(path,
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+        "Referer: http://localhost/index.html\r\n"
+        "Cookie: sessionid=0f3c1d2e-5b6a-4c7d-8e9f-a0b1c2d3e4f5; theme=dark\r\n"
+        "Cache-Control: no-cache\r\n"
+        + headers);
+}
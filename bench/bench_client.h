@@ -0,0 +1,100 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+#ifndef _BenchClient_H_
+#define _BenchClient_H_
+
+#include <QByteArray>
+#include <QList>
+#include <functional>
+
+class QTcpSocket;
+
+/**
+ * @brief Time limit of blocking operations of the client in milliseconds
+ */
+#define BENCH_CLIENT_TIMEOUT 30000
+
+/**
+ * @brief Blocking HTTP client of the benchmarks
+ *
+ * The client must be created and used in the thread of runClient().
+ * Only responses with Content-Length are supported.
+ */
+class BenchClient {
+  public:
+   ~BenchClient();
+    BenchClient();
+
+    /**
+     * @brief Connects to the server on the loopback interface
+     */
+    bool    connectToServer(int port);
+
+    /**
+     * @brief Reads at most size bytes and then sleeps for pause milliseconds
+     *
+     * The socket buffers are limited to size bytes too, the server has to wait for the client.
+     */
+    void    setThrottle(int size, int pause);
+
+    /**
+     * @brief Writes the data and waits until they are sent
+     */
+    bool    send(const QByteArray& data);
+
+    /**
+     * @brief Reads one response, the body is discarded
+     *
+     * @param bodySize - size of the body is stored here
+     * @returns status code of the response or -1 on error
+     */
+    int     readResponse(qint64 *bodySize = NULL);
+
+    /**
+     * @brief Returns true while the connection is open
+     *
+     * Received data are read without waiting, the connection closed by the server is detected then.
+     */
+    bool    isConnected();
+
+    /**
+     * @brief Returns the text of GET request with Host header and given extra headers
+     */
+    static QByteArray request(const QByteArray& path, const QByteArray& headers = QByteArray());
+
+    /**
+     * @brief Returns the text of GET request with typical headers of a browser
+     */
+    static QByteArray browserRequest(const QByteArray& path, const QByteArray& headers = QByteArray());
+
+  private:
+    #ifndef DOXYGEN_SHOULD_SKIP_THIS
+    BenchClient(const BenchClient&);
+    BenchClient& operator=(const BenchClient&);
+    bool        fill();
+
+    QTcpSocket *m_socket;
+    QByteArray  m_buffer;
+    int         m_throttleSize;
+    int         m_throttlePause;
+    #endif
+};
+
+
+/**
+ * @brief Runs the client part of a benchmark in a new thread
+ *
+ * The event loop of the main thread runs the server meanwhile. The function returns
+ * when the client is finished.
+ */
+void runClient(const std::function<void()>& client);
+
+/**
+ * @brief Runs more clients at once, each in its own thread
+ */
+void runClients(const QList<std::function<void()> >& clients);
+
+#endif
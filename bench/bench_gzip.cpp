@@ -0,0 +1,115 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ *
+ * Throughput of gzip compression and CRC32 compared with zlib
+ */
+
+#include "bench.h"
+#include "httpgzipcompression.h"
+#include <QElapsedTimer>
+#include <zlib.h>
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+volatile quint32 sink;
+
+/**
+ * @brief Repeats the function for BENCH_DURATION, returns processed megabytes per second
+ */
+template <typename Function>
+double throughput(qint64 bytes, Function function) {
+    QElapsedTimer timer;
+    timer.start();
+    qint64 iterations = 0;
+    do {
+        function();
+        iterations++;
+        } while (timer.elapsed() < BENCH_DURATION);
+    return double(bytes) * iterations / (timer.nsecsElapsed() / 1e9) / (1024 * 1024);
+}
+
+
+/**
+ * @brief Reference implementation, gzip stream written by zlib itself
+ */
+QByteArray zlibGzip(const QByteArray& data, int level) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    QByteArray output;
+    output.resize(deflateBound(&stream, data.size()));
+    stream.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in  = data.size();
+    stream.next_out  = reinterpret_cast<Bytef *>(output.data());
+    stream.avail_out = output.size();
+    deflate(&stream, Z_FINISH);
+    output.resize(output.size() - stream.avail_out);
+    deflateEnd(&stream);
+    return output;
+}
+#endif
+
+}
+
+
+void benchGzip() {
+    QByteArray data = sample(1024 * 1024);
+    QList<int> levels = QList<int>()
+        << HttpGZipCompression::BestSpeed
+        << 6
+        << HttpGZipCompression::BestCompression;
+
+    for (int i=0; i<levels.size(); i++) {
+        int level = levels[i];
+        QByteArray name = "gzip level " + QByteArray::number(level);
+
+        double rate = throughput(data.size(), [&]() {
+            sink = HttpGZipCompression::compressData(data, level).size();
+            });
+        report(name.constData(), rate, "MB/s");
+
+        rate = throughput(data.size(), [&]() {
+            sink = zlibGzip(data, level).size();
+            });
+        report((name + " (zlib gzip wrapper)").constData(), rate, "MB/s");
+
+        double ratio = 100.0 * HttpGZipCompression::compressData(data, level).size() / data.size();
+        report((name + " compressed size").constData(), ratio, "%");
+        }
+
+    // Chunked responses, parts of 16 kB
+    double rate = throughput(data.size(), [&]() {
+        HttpGZipStream stream;
+        quint32 size = 0;
+        for (int offset=0; offset<data.size(); offset += 16384) {
+            size += stream.compress(data.mid(offset, 16384)).size();
+            }
+        sink = size + stream.finish().size();
+        });
+    report("gzip stream, 16 kB parts", rate, "MB/s");
+}
+
+
+void benchCrc32() {
+    QByteArray data = sample(16 * 1024 * 1024);
+
+    double rate = throughput(data.size(), [&]() {
+        sink = HttpGZipCompression::crc32(data.constData(), data.size());
+        });
+    report("crc32 slicing-by-8", rate, "MB/s");
+
+    rate = throughput(data.size(), [&]() {
+        sink = quint32(::crc32(0L, reinterpret_cast<const Bytef *>(data.constData()), data.size()));
+        });
+    report("crc32 zlib", rate, "MB/s");
+
+    // Small blocks, typical size of a response
+    QByteArray small = data.left(1024);
+    rate = throughput(small.size(), [&]() {
+        sink = HttpGZipCompression::crc32(small.constData(), small.size());
+        });
+    report("crc32 slicing-by-8, 1 kB", rate, "MB/s");
+}
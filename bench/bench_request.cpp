@@ -0,0 +1,64 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ *
+ * Parsing of requests
+ */
+
+#include "bench.h"
+#include "bench_server.h"
+#include "bench_client.h"
+#include <QElapsedTimer>
+
+
+void benchRequests() {
+    BenchServer server;
+    server.start();
+
+    // Headers of a browser, the response has empty body
+    QByteArray request = BenchClient::browserRequest("/0?page=1&sort=name", "Connection: keep-alive\r\n");
+
+    // Requests one by one, then pipelined in batches
+    QList<int> depths = QList<int>() << 1 << 16;
+    for (int d=0; d<depths.size(); d++) {
+        QByteArray name = "requests, pipeline depth " + QByteArray::number(depths[d]);
+        QByteArray batch = request.repeated(depths[d]);
+        qint64 requests = 0;
+        double wall = 0;
+        double cpu = 0;
+        bool ok = false;
+
+        runClient([&]() {
+            BenchClient client;
+            if (!client.connectToServer(server.port())) {
+                return;
+                }
+            QElapsedTimer timer;
+            timer.start();
+            double cpu0 = serverCpuTime();
+            while (timer.elapsed() < BENCH_DURATION) {
+                if (!client.send(batch)) {
+                    return;
+                    }
+                for (int i=0; i<depths[d]; i++) {
+                    if (client.readResponse() != 200) {
+                        return;
+                        }
+                    }
+                requests += depths[d];
+                }
+            cpu  = serverCpuTime() - cpu0;
+            wall = timer.nsecsElapsed() / 1e9;
+            ok = true;
+            });
+
+        if (!ok) {
+            reportFailure(name.constData());
+            continue;
+            }
+        report((name + ", rate").constData(), requests / wall, "req/s");
+        report((name + ", server CPU").constData(), cpu * 1e6 / requests, "us/req");
+        report((name + ", server rate per core").constData(), requests / cpu, "req/s");
+        }
+}
@@ -0,0 +1,99 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ *
+ * Writing of responses to the socket
+ */
+
+#include "bench.h"
+#include "bench_server.h"
+#include "bench_client.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <algorithm>
+
+
+void benchLargeBody() {
+    BenchServer server;
+    server.start();
+
+    // 10 MB body read at full speed, then by a client reading 16 kB every millisecond
+    const qint64 size = 10 * 1024 * 1024;
+    for (int throttled=0; throttled<2; throttled++) {
+        QByteArray name = throttled ? "10 MB body, throttled client" : "10 MB body";
+        qint64 received = 0;
+        int status = -1;
+        double wall = 0;
+        double cpu = 0;
+
+        runClient([&]() {
+            BenchClient client;
+            if (!client.connectToServer(server.port())) {
+                return;
+                }
+            if (throttled) {
+                client.setThrottle(16384, 1);
+                }
+            QElapsedTimer timer;
+            timer.start();
+            double cpu0 = serverCpuTime();
+            if (client.send(BenchClient::request("/" + QByteArray::number(size)))) {
+                status = client.readResponse(&received);
+                }
+            cpu  = serverCpuTime() - cpu0;
+            wall = timer.nsecsElapsed() / 1e9;
+            });
+
+        if (status != 200 || received != size) {
+            reportFailure(name.constData());
+            continue;
+            }
+        report((name + ", time").constData(), wall * 1000, "ms");
+        report((name + ", server CPU").constData(), cpu * 1000, "ms");
+        }
+}
+
+
+void benchLatency() {
+    BenchServer server;
+    server.start();
+
+    // Time from sending the request to reading the whole response, sequential requests on one connection
+    const int warmup = 100;
+    const int count = 5000;
+    QList<int> sizes = QList<int>() << 100 << 65536;
+    for (int s=0; s<sizes.size(); s++) {
+        QByteArray name = "response latency, " + QByteArray::number(sizes[s]) + " B body";
+        QVector<qint64> latencies;
+        bool ok = false;
+
+        runClient([&]() {
+            BenchClient client;
+            if (!client.connectToServer(server.port())) {
+                return;
+                }
+            QByteArray request = BenchClient::request("/" + QByteArray::number(sizes[s]));
+            QElapsedTimer timer;
+            for (int i=0; i<warmup + count; i++) {
+                timer.start();
+                if (!client.send(request) || client.readResponse() != 200) {
+                    return;
+                    }
+                if (i >= warmup) {
+                    latencies << timer.nsecsElapsed();
+                    }
+                }
+            ok = true;
+            });
+
+        if (!ok) {
+            reportFailure(name.constData());
+            continue;
+            }
+        std::sort(latencies.begin(), latencies.end());
+        report((name + ", p50").constData(), latencies[count / 2] / 1000.0, "us");
+        report((name + ", p99").constData(), latencies[count * 99 / 100] / 1000.0, "us");
+        report((name + ", max").constData(), latencies.last() / 1000.0, "us");
+        }
+}
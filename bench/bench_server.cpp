@@ -0,0 +1,60 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "bench_server.h"
+#include "httpsettings.h"
+#include "httprequest.h"
+#include "httpresponse.h"
+#include <QTcpServer>
+#include <QHash>
+
+using namespace HobrasoftHttpd;
+
+
+HttpSettings *BenchServer::createSettings() {
+    // The port is free at least for a while
+    QTcpServer probe;
+    probe.listen(QHostAddress::LocalHost, 0);
+
+    HttpSettings *settings = new HttpSettings(NULL);
+    settings->setAddress(QHostAddress::LocalHost);
+    settings->setPort(probe.serverPort());
+    settings->setThreads(false);
+    return settings;
+}
+
+
+BenchServer::BenchServer(HttpSettings *settings) : HttpServer(settings, NULL) {
+    settings->setParent(this);
+}
+
+
+int BenchServer::port() const {
+    return settings()->port();
+}
+
+
+HttpRequestHandler *BenchServer::requestHandler(HttpConnection *connection) {
+    return new BenchHandler(connection);
+}
+
+
+BenchHandler::BenchHandler(HttpConnection *connection) : HttpRequestHandler(connection) {
+}
+
+
+void BenchHandler::service(HttpRequest *request, HttpResponse *response) {
+    // Bodies are shared, the benchmarks do not measure their allocation
+    static QHash<int, QByteArray> bodies;
+    int size = request->path().mid(1).toInt();
+    if (!bodies.contains(size)) {
+        bodies.insert(size, QByteArray(size, 'x'));
+        }
+
+    response->setHeader("Content-Type", "application/octet-stream");
+    response->write(bodies.value(size));
+    response->flush();
+}
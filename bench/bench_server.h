@@ -0,0 +1,56 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+#ifndef _BenchServer_H_
+#define _BenchServer_H_
+
+#include "httpserver.h"
+#include "httprequesthandler.h"
+
+namespace HobrasoftHttpd {
+class HttpSettings;
+class HttpRequest;
+class HttpResponse;
+}
+
+/**
+ * @brief Server of the benchmarks, it listens on a free port of the loopback interface
+ *
+ * The server runs in the main thread, clients run in their own threads, see runClient().
+ * Every request is answered with a body of the size given in the path,
+ * GET /1024 returns 1024 bytes.
+ */
+class BenchServer : public HobrasoftHttpd::HttpServer {
+  public:
+
+    /**
+     * @brief Returns new settings of the server, they can be changed before the server is created
+     */
+    static HobrasoftHttpd::HttpSettings *createSettings();
+
+    /**
+     * @brief Constructor, the server takes the ownership of the settings
+     */
+    BenchServer(HobrasoftHttpd::HttpSettings *settings = createSettings());
+
+    /**
+     * @brief Returns the port of the server
+     */
+    int port() const;
+
+    HobrasoftHttpd::HttpRequestHandler *requestHandler(HobrasoftHttpd::HttpConnection *connection);
+};
+
+
+/**
+ * @brief Handler of the benchmark requests
+ */
+class BenchHandler : public HobrasoftHttpd::HttpRequestHandler {
+  public:
+    BenchHandler(HobrasoftHttpd::HttpConnection *connection);
+    void service(HobrasoftHttpd::HttpRequest *request, HobrasoftHttpd::HttpResponse *response);
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ *
+ * Throughput of a regular client while slow clients occupy the server
+ */
+
+#include "bench.h"
+#include "bench_server.h"
+#include "bench_client.h"
+#include "httpsettings.h"
+#include <QElapsedTimer>
+#include <QThread>
+
+using namespace HobrasoftHttpd;
+
+/**
+ * @brief Number of slow connections
+ */
+#define SLOW_CLIENTS 200
+
+/**
+ * @brief Duration of the throughput measurement in milliseconds, longer than the header timeout
+ */
+#define SLOW_DURATION 3000
+
+
+void benchSlowClients() {
+    HttpSettings *settings = BenchServer::createSettings();
+    settings->setHeaderTimeout(2);
+    BenchServer server(settings);
+    server.start();
+
+    // Sequential requests of a regular client, it starts after the slow clients are connected
+    qint64 requests = 0;
+    double wall = 0;
+    bool ok = false;
+    std::function<void()> regular = [&]() {
+        QThread::msleep(500);
+        BenchClient client;
+        if (!client.connectToServer(server.port())) {
+            return;
+            }
+        QByteArray request = BenchClient::request("/100");
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.elapsed() < SLOW_DURATION) {
+            if (!client.send(request) || client.readResponse() != 200) {
+                return;
+                }
+            requests++;
+            }
+        wall = timer.nsecsElapsed() / 1e9;
+        ok = true;
+        };
+
+    // Slow clients send one byte of the request head every 100 ms
+    int connected = 0;
+    int closed = 0;
+    std::function<void()> slow = [&]() {
+        QList<BenchClient *> clients;
+        for (int i=0; i<SLOW_CLIENTS; i++) {
+            BenchClient *client = new BenchClient();
+            clients << client;
+            if (client->connectToServer(server.port())) {
+                connected++;
+                }
+            }
+
+        QByteArray request = BenchClient::request("/100");
+        QElapsedTimer timer;
+        timer.start();
+        for (int sent=0; timer.elapsed() < SLOW_DURATION + 500; sent++) {
+            for (int i=0; i<clients.size(); i++) {
+                if (clients[i]->isConnected()) {
+                    clients[i]->send(request.mid(sent % request.size(), 1));
+                    }
+                }
+            QThread::msleep(100);
+            }
+
+        // The response of the server is read first, the end of the stream then
+        for (int i=0; i<clients.size(); i++) {
+            bool open = clients[i]->isConnected() && clients[i]->isConnected();
+            if (!open) {
+                closed++;
+                }
+            }
+        qDeleteAll(clients);
+        };
+
+    runClient(regular);
+    if (!ok) {
+        reportFailure("regular client");
+        return;
+        }
+    report("regular client alone", requests / wall, "req/s");
+
+    requests = 0;
+    ok = false;
+    runClients(QList<std::function<void()> >() << regular << slow);
+    if (!ok) {
+        reportFailure("regular client with slow clients");
+        return;
+        }
+    report("regular client with slow clients", requests / wall, "req/s");
+    report("slow clients connected", connected, "");
+    report("slow clients closed by header timeout", closed, "");
+}
@@ -1,5 +1,17 @@
 INCLUDEPATH += $$PWD
 DEPENDPATH  += $$PWD
+LIBS        += -lz
+win32:LIBS  += -lws2_32
+
+# Optional brotli and zstd content codings
+brotli {
+    DEFINES += HOBRASOFTHTTPD_BROTLI
+    LIBS    += -lbrotlienc
+}
+zstd {
+    DEFINES += HOBRASOFTHTTPD_ZSTD
+    LIBS    += -lzstd
+}
 
 HEADERS += \
  $$PWD/hobrasofthttpd.h \
@@ -15,7 +27,12 @@ HEADERS += \
  $$PWD/httpsessionstore.h \
  $$PWD/httpsettings.h \
  $$PWD/httptcpserver.h \
+ $$PWD/httpsslhandshake.h \
+ $$PWD/httptimerwheel.h \
  $$PWD/httpgzipcompression.h \
+ $$PWD/httpcontentcache.h \
+ $$PWD/httpcontentencoding.h \
+ $$PWD/httpmultipartparser.h \
  $$PWD/testsettings.h \
 
 
@@ -32,5 +49,10 @@ SOURCES += \
  $$PWD/httpsessionstore.cpp \
  $$PWD/httpsettings.cpp \
  $$PWD/httpgzipcompression.cpp \
+ $$PWD/httpcontentcache.cpp \
+ $$PWD/httpcontentencoding.cpp \
+ $$PWD/httpmultipartparser.cpp \
  $$PWD/httptcpserver.cpp \
+ $$PWD/httpsslhandshake.cpp \
+ $$PWD/httptimerwheel.cpp \
 
@@ -11,41 +11,88 @@
 #include "httpresponse.h"
 #include "httpserver.h"
 #include "httpsettings.h"
+#include "httpgzipcompression.h"
 #include <QTcpSocket>
+#include <QTimer>
+#include <QEvent>
 
 using namespace HobrasoftHttpd;
 
+/**
+ * @brief Number of finished requests kept for webStatus() in each connection
+ */
+#define REQUEST_HISTORY_SIZE 16
+
+/**
+ * @brief Initial capacity of the receive buffer, the capacity is kept when the buffer is emptied
+ */
+#define RECEIVE_BUFFER_SIZE 16384
+
+/**
+ * @brief Limit of data buffered in the socket, reading of the socket stops when the buffer is full
+ */
+#define SOCKET_READ_BUFFER_SIZE 65536
+
+/**
+ * @brief Number of queued responses, next pipelined request is not parsed until some of them are written
+ */
+#define PIPELINE_RESPONSES_LIMIT 16
+
+/**
+ * @brief Unsent data in the socket, next pipelined request is not parsed until they are written
+ */
+#define PIPELINE_WRITE_LIMIT 65536
+
 HttpConnection::~HttpConnection() {
     close();
     for (int i=0; i<m_requests.size(); i++) {
-        delete m_requests[i];
+        HttpRequest::release(m_requests[i]);
+        m_parent->requestFinished();
         }
+    m_parent->addBufferedBytes(-m_bufferedBytes);
+    m_parent->peerClosed(m_peerAddress);
+    delete m_gzipStream;
 }
 
 
-HttpConnection::HttpConnection(HttpServer *parent, QTcpSocket *socket) : QObject(parent) {
+HttpConnection::HttpConnection(HttpServer *parent, QTcpSocket *socket) : QObject(parent),
+        m_timeout(this, "slotTimeout"),
+        m_writeTimeout(this, "slotWriteTimeout"),
+        m_headerTimeout(this, "slotReadTimeout"),
+        m_bodyTimeout(this, "slotReadTimeout") {
     m_peerAddress = socket->peerAddress();
     m_socket = socket;
     m_request = NULL;
+    m_serviced = NULL;
+    m_gzipStream = NULL;
     m_parent  = parent;
     m_handler = parent->requestHandler(this);
     m_connected = true;
     m_inService = true;
-
-    int timeout = settings()->timeout() * 1000;
-
-    m_timeout = new QTimer(this);
-    m_timeout->setInterval(timeout);
-    m_timeout->setSingleShot(true);
+    m_chunked = false;
+    m_closing = false;
+    m_bufferPos = 0;
+    m_bufferedBytes = 0;
+    m_bodyBytes = 0;
+    m_idle = false;
+    m_buffer.reserve(RECEIVE_BUFFER_SIZE);
+    m_readingPaused = false;
+    m_pipelineFull = false;
+    m_socket->setReadBufferSize(SOCKET_READ_BUFFER_SIZE);
+    m_history.setCapacity(REQUEST_HISTORY_SIZE);
+
+    m_timeoutInterval = settings()->timeout() * 1000;
     startTimeout();
-    connect (m_timeout, SIGNAL(timeout()),
-             this,        SLOT(slotTimeout()));
+    updateReadDeadlines();
 
     connect(m_socket, SIGNAL(readyRead()),
             this,     SLOT(slotRead()));
 
     connect(m_socket, SIGNAL(disconnected()),
             this,     SLOT(slotDisconnected()));
+
+    connect(m_socket, SIGNAL(bytesWritten(qint64)),
+            this,     SLOT(writeProgress()));
 }
 
 const HttpSettings *HttpConnection::settings() const { 
@@ -54,11 +101,158 @@ const HttpSettings *HttpConnection::settings() const {
 
 
 void HttpConnection::startTimeout() {
-    if (m_timeout->interval() == 0) {
-        m_timeout->stop();
+    if (m_timeoutInterval <= 0) {
+        m_timeout.stop();
         return;
         }
-    m_timeout->start();
+    m_timeout.start(m_timeoutInterval);
+}
+
+
+void HttpConnection::writeProgress() {
+    reportBufferedBytes();
+    resumePipeline();
+    if (!isConnected() || m_timeoutInterval <= 0 || m_socket->bytesToWrite() <= 0) {
+        m_writeTimeout.stop();
+        return;
+        }
+    m_writeTimeout.start(m_timeoutInterval);
+}
+
+
+/**
+ * @brief Timers belong to the timer wheel of the thread
+ *
+ * The connection is created in the thread of the server and it can be moved to its own thread.
+ * Timers are stopped in the old thread, the queued slot starts them in the new thread.
+ */
+bool HttpConnection::event(QEvent *event) {
+    if (event->type() == QEvent::ThreadChange) {
+        m_timeout.stop();
+        m_writeTimeout.stop();
+        m_headerTimeout.stop();
+        m_bodyTimeout.stop();
+        QMetaObject::invokeMethod(this, "slotThreadChanged", Qt::QueuedConnection);
+        }
+    return QObject::event(event);
+}
+
+
+void HttpConnection::slotThreadChanged() {
+    if (!isConnected()) { return; }
+    if (!m_readingPaused) {
+        startTimeout();
+        updateReadDeadlines();
+        }
+    writeProgress();
+}
+
+
+/**
+ * @brief Starts or stops deadlines of reading the current request
+ *
+ * The request line and headers must be received within headerTimeout() from the beginning
+ * of the request (or from the connection), the deadline is not extended by received data.
+ * The body must be received at minBodyRate() after the grace period of headerTimeout().
+ * Trickling clients cannot hold the connection and the request forever.
+ */
+void HttpConnection::updateReadDeadlines() {
+    int headerTimeout = settings()->headerTimeout() * 1000;
+    int minBodyRate = settings()->minBodyRate();
+    HttpRequest::Status status = (m_request != NULL) ? m_request->status() :
+                                 (m_idle) ? HttpRequest::StatusComplete : HttpRequest::StatusWaitForRequest;
+
+    if (!isConnected() || m_readingPaused || m_chunked || m_closing) {
+        m_headerTimeout.stop();
+        m_bodyTimeout.stop();
+        return;
+        }
+
+    if (status == HttpRequest::StatusWaitForRequest || status == HttpRequest::StatusWaitForHeader) {
+        m_bodyTimeout.stop();
+        if (headerTimeout > 0 && !m_headerTimeout.isActive()) {
+            m_headerTimeout.start(headerTimeout);
+            }
+        return;
+        }
+
+    m_headerTimeout.stop();
+    if (status != HttpRequest::StatusWaitForBody || !m_request->isAdmitted() || minBodyRate <= 0) {
+        m_bodyTimeout.stop();
+        m_bodyClock.invalidate();
+        return;
+        }
+
+    if (!m_bodyClock.isValid()) {
+        m_bodyClock.start();
+        m_bodyBytes = 0;
+        }
+    qint64 deadline = headerTimeout + m_bodyBytes * 1000 / minBodyRate;
+    m_bodyTimeout.start(qMax(deadline - m_bodyClock.elapsed(), (qint64)0));
+}
+
+
+/**
+ * @brief Reads the current request from the receive buffer, counts received body
+ */
+void HttpConnection::readRequest() {
+    bool body = (m_request->status() == HttpRequest::StatusWaitForBody);
+    int pos = m_bufferPos;
+    m_bufferPos = m_request->readFromBuffer(m_buffer, m_bufferPos);
+    if (body) {
+        m_bodyBytes += m_bufferPos - pos;
+        }
+}
+
+
+void HttpConnection::setGZipStream(HttpGZipStream *stream) {
+    if (stream == m_gzipStream) { return; }
+    delete m_gzipStream;
+    m_gzipStream = stream;
+}
+
+
+void HttpConnection::addResponse(HttpResponse *response) {
+    m_responses << response;
+    connect(response, SIGNAL(destroyed(QObject *)),
+            this,       SLOT(slotResponseDestroyed(QObject *)));
+}
+
+
+bool HttpConnection::isCurrentResponse(HttpResponse *response) const {
+    for (int i=0; i<m_responses.size(); i++) {
+        if (m_responses[i] == response) {
+            return true;
+            }
+        if (!m_responses[i]->yieldsTo(response)) {
+            return false;
+            }
+        }
+    return false;
+}
+
+
+void HttpConnection::writeNextResponse(HttpResponse *response) {
+    int index = m_responses.indexOf(response);
+    if (index < 0 || index + 1 >= m_responses.size()) { return; }
+    QMetaObject::invokeMethod(m_responses[index + 1], "slotWrite", Qt::QueuedConnection);
+}
+
+
+void HttpConnection::slotResponseDestroyed(QObject *object) {
+    bool current = !m_responses.isEmpty() && m_responses.first() == object;
+    m_responses.removeAll(static_cast<HttpResponse *>(object));
+    releaseRequests();
+    resumePipeline();
+    if (!current) { return; }
+
+    // Next pipelined response or chunks of an event stream may wait with their data for the socket
+    for (int i=0; i<m_responses.size(); i++) {
+        if (!isCurrentResponse(m_responses[i])) {
+            break;
+            }
+        QMetaObject::invokeMethod(m_responses[i], "slotWrite", Qt::QueuedConnection);
+        }
 }
 
 
@@ -102,11 +296,32 @@ void HttpConnection::slotTimeout() {
 }
 
 
+/**
+ * @brief The request line, headers or body is not received in time
+ */
+void HttpConnection::slotReadTimeout() {
+    m_parent->requestTimedOut();
+    slotTimeout();
+}
+
+
+/**
+ * @brief The client does not read written data, the connection is aborted
+ */
+void HttpConnection::slotWriteTimeout() {
+    if (!isConnected()) { return; }
+    m_socket->abort();
+}
+
+
 void HttpConnection::slotDisconnected() {
     m_connected = false;
     m_socket->close();
     deleteRequest();
-    m_timeout->stop();
+    m_timeout.stop();
+    m_writeTimeout.stop();
+    m_headerTimeout.stop();
+    m_bodyTimeout.stop();
     if (m_inService) {
         QTimer::singleShot(3000, this, SLOT(deleteLater()));
       } else {
@@ -117,42 +332,172 @@ void HttpConnection::slotDisconnected() {
 
 HttpResponse *HttpConnection::response() {
     startTimeout();
-    return new HttpResponse(this);
+    return new HttpResponse(this, request());
+}
+
+
+void HttpConnection::pauseReading() {
+    m_readingPaused = true;
+    m_timeout.stop();
+    updateReadDeadlines();
+}
+
+
+void HttpConnection::resumeReading() {
+    if (!m_readingPaused) { return; }
+    m_readingPaused = false;
+    startTimeout();
+    // Time of the pause is not counted to the body rate
+    m_bodyClock.invalidate();
+    updateReadDeadlines();
+    // Data buffered in the socket do not emit readyRead() again
+    QMetaObject::invokeMethod(this, "slotRead", Qt::QueuedConnection);
 }
 
 
+/**
+ * @brief Returns true if received data would be parsed
+ *
+ * Data are not read from the socket when no request is parsed: reading is paused by the handler,
+ * the connection carries a chunked response or is being closed, the current request
+ * was aborted or refused, or too many responses wait for the socket.
+ * Data stay in the socket and the client is slowed down by TCP.
+ */
+bool HttpConnection::isReading() const {
+    if (!isConnected() || m_readingPaused || m_chunked || m_closing || m_pipelineFull) {
+        return false;
+        }
+    return m_request == NULL || m_request->status() != HttpRequest::StatusAbort;
+}
+
+
+/**
+ * @brief Reads the socket to the receive buffer and services complete requests
+ *
+ * The receive buffer holds at most maxRequestSize() plus RECEIVE_BUFFER_SIZE bytes
+ * of unparsed data. Longer head is aborted by the request, so the connection
+ * which fills the buffer without any progress is closed.
+ */
 void HttpConnection::slotRead() {
-    if (!isConnected()) { return; }
+    if (!isReading()) { return; }
     startTimeout();
-    if (m_request == NULL || (m_request != NULL && m_request->status() == HttpRequest::StatusComplete)) {
-        m_request = new HttpRequest(this);
-        m_requests << m_request;
+
+    int limit = settings()->maxRequestSize() + RECEIVE_BUFFER_SIZE;
+    for (;;) {
+        // Socket data are read directly to the end of the receive buffer
+        qint64 available = qMin(m_socket->bytesAvailable(), (qint64)(limit - m_buffer.size()));
+        if (available > 0) {
+            int size = m_buffer.size();
+            m_buffer.resize(size + available);
+            qint64 received = m_socket->read(m_buffer.data() + size, available);
+            m_buffer.resize(size + qMax(received, (qint64)0));
+            }
+
+        serviceRequests();
+        if (!isConnected()) { return; }
+
+        // Consumed data are removed, incomplete request stays at the beginning of the buffer
+        if (m_bufferPos > 0) {
+            m_buffer.remove(0, m_bufferPos);
+            m_bufferPos = 0;
+            }
+
+        if (isReading() && m_buffer.size() >= limit) {
+            qWarning("HttpConnection: receive buffer is full, closing the connection");
+            m_closing = true;
+            close();
+            break;
+            }
+
+        // Data left in the socket do not emit readyRead() again
+        if (!isReading() || m_socket->bytesAvailable() <= 0) {
+            break;
+            }
         }
 
-    while (m_socket->bytesAvailable() 
-            && m_request->status() != HttpRequest::StatusComplete
-            && m_request->status() != HttpRequest::StatusAbort) {
-        m_request->readFromSocket(m_socket);
+    updateReadDeadlines();
+    reportBufferedBytes();
+}
+
+
+/**
+ * @brief Parses the receive buffer, all complete requests are serviced in order
+ */
+void HttpConnection::serviceRequests() {
+    // Pipelined requests can be read at once
+    while (isReading()) {
+        if (m_request == NULL || m_request->status() == HttpRequest::StatusComplete) {
+            if (m_bufferPos >= m_buffer.size()) {
+                break;
+                }
+            if (isPipelineFull()) {
+                m_pipelineFull = true;
+                break;
+                }
+            m_request = HttpRequest::create(this);
+            m_idle = false;
+            m_requests << m_request;
+            m_parent->requestStarted();
+            m_headerTimeout.stop();
+            releaseRequests();
+            }
+
+        readRequest();
+
+        // Overloaded server refuses new requests before their body is read
+        if (!m_request->isAdmitted() &&
+                (m_request->status() == HttpRequest::StatusWaitForBody || m_request->status() == HttpRequest::StatusComplete) &&
+                m_parent->isOverloaded()) {
+            if (!refuseOverloaded()) {
+                m_timeout.stop();
+                break;
+                }
+            finishRequest();
+            continue;
+            }
+
+        // Head is complete, the request is admitted or refused before the body is read
+        if (m_request->status() == HttpRequest::StatusWaitForBody && !m_request->isAdmitted()) {
+            if (!admitRequest()) {
+                m_timeout.stop();
+                return;
+                }
+            readRequest();
+            }
+
+        if (m_request->isBodyStreamed()) {
+            QByteArray data = m_request->takeBodyData();
+            if (!data.isEmpty()) {
+                m_handler->bodyData(m_request, data);
+                }
+            if (!isConnected()) {
+                return;
+                }
+            }
+
         if (m_request->status() == HttpRequest::StatusWaitForBody) {
             startTimeout();
             }
-        }
 
-    if (m_request->status() == HttpRequest::StatusAbort) {
-        m_socket->write("HTTP/1.1 413 entity too large\r\n");
-        m_socket->write("Connection: close\r\n\r\n");
-        m_socket->write("\r\n");
-        m_socket->write("413 entity too large\r\n");
-        m_socket->disconnectFromHost();
-        m_timeout->stop();
-        deleteRequest();
-        return;
-        }
+        if (m_request->status() == HttpRequest::StatusAbort) {
+            // Responses to previous requests are written before the connection is closed
+            HttpResponse *response = new HttpResponse(this, m_request);
+            response->setStatus(413, "entity too large");
+            response->setHeader("Connection", "close");
+            response->write("413 entity too large\r\n");
+            response->flushAndClose();
+            m_timeout.stop();
+            return;
+            }
     
-    if (m_request->status() == HttpRequest::StatusComplete) {
-        bool disconnect = (m_request->header("Connection").toLower() == "close");
-        m_timeout->stop();
-        HttpResponse *response = new HttpResponse(this);
+        if (m_request->status() != HttpRequest::StatusComplete) {
+            break;
+            }
+
+        // The response closes the connection, following requests are not serviced
+        m_closing = !m_request->keepAlive();
+        m_timeout.stop();
+        HttpResponse *response = new HttpResponse(this, m_request);
         m_inService = true;
         m_handler->service(m_request, response);
         m_inService = false;
@@ -162,17 +507,132 @@ void HttpConnection::slotRead() {
             return; 
             }
 
-        if (disconnect) {
-            if (isConnected()) { 
-                m_socket->disconnectFromHost(); 
-                deleteRequest();
+        finishRequest();
+        startTimeout();
+        }
+}
+
+
+/**
+ * @brief Decides about the request with body when its headers are complete
+ *
+ * Unknown expectations are refused with 417. The handler can refuse the request
+ * in HttpRequestHandler::admitRequest(). Refused request is answered without
+ * reading its body and the connection is closed after the response.
+ *
+ * Client waiting for "100 Continue" gets the interim response when the request
+ * is admitted and its body is within limits.
+ *
+ * @returns false if the request was refused
+ */
+bool HttpConnection::admitRequest() {
+    QString expect = m_request->header(HttpRequest::HeaderExpect).trimmed();
+    bool expectContinue = (expect.compare("100-continue", Qt::CaseInsensitive) == 0);
+
+    HttpResponse *response = new HttpResponse(this, m_request);
+    if (!expect.isEmpty() && !expectContinue) {
+        response->setStatus(417, "Expectation Failed");
+        response->write("417 expectation failed\r\n");
+        }
+
+    if (expect.isEmpty() || expectContinue) {
+        if (m_handler->admitRequest(m_request, response)) {
+            delete response;
+            m_request->admit(m_handler->streamBody(m_request));
+            if (expectContinue && m_request->status() == HttpRequest::StatusWaitForBody && m_request->version() == "HTTP/1.1") {
+                HttpResponse *interim = new HttpResponse(this, m_request);
+                interim->setStatus(100, "Continue");
+                interim->flush();
                 }
-          } else {
-            startTimeout();
+            return true;
             }
+        if (response->statusCode() < 400) {
+            response->setStatus(403, "Forbidden");
+            }
+        }
 
+    // Unread body would be parsed as the next request, the connection has to be closed
+    m_request->reject();
+    response->setHeader("Connection", "close");
+    response->flushAndClose();
+    return false;
+}
+
+
+/**
+ * @brief Answers the request with 503 response when the server is overloaded
+ *
+ * Request without body is answered and the connection stays open.
+ * The body of the request is not read, the connection is closed after the response then.
+ *
+ * @returns false if the connection is closed
+ */
+bool HttpConnection::refuseOverloaded() {
+    m_parent->requestRefused();
+    HttpResponse *response = new HttpResponse(this, m_request);
+    response->setStatus(503, "Service Unavailable");
+    response->setHeader("Retry-After", settings()->retryAfter());
+    response->write("503 service unavailable\r\n");
+
+    if (m_request->status() == HttpRequest::StatusComplete) {
+        m_closing = !m_request->keepAlive();
+        response->flush();
+        return true;
+        }
+
+    m_request->reject();
+    response->setHeader("Connection", "close");
+    response->flushAndClose();
+    return false;
+}
+
+
+/**
+ * @brief Returns true if the client does not read responses as fast as it sends pipelined requests
+ */
+bool HttpConnection::isPipelineFull() const {
+    return m_responses.size() >= PIPELINE_RESPONSES_LIMIT ||
+           m_socket->bytesToWrite() >= PIPELINE_WRITE_LIMIT;
+}
+
+
+/**
+ * @brief Continues parsing of pipelined requests when queued responses are written
+ *
+ * Requests left in the receive buffer or in the socket do not emit readyRead() again.
+ */
+void HttpConnection::resumePipeline() {
+    if (!m_pipelineFull || !isConnected() || isPipelineFull()) { return; }
+    m_pipelineFull = false;
+    QMetaObject::invokeMethod(this, "slotRead", Qt::QueuedConnection);
+}
+
+
+/**
+ * @brief Reports the change of received and unsent data to the server
+ */
+void HttpConnection::reportBufferedBytes() {
+    int bytes = m_buffer.size();
+    if (isConnected()) {
+        bytes += m_socket->bytesToWrite();
         }
+    if (bytes == m_bufferedBytes) { return; }
+    m_parent->addBufferedBytes(bytes - m_bufferedBytes);
+    m_bufferedBytes = bytes;
+}
+
 
+/**
+ * @brief The current request is answered, it is not current anymore
+ *
+ * The request is released as soon as its responses are written, idle keep-alive
+ * connection does not hold any request.
+ */
+void HttpConnection::finishRequest() {
+    m_serviced = m_request;
+    m_request = NULL;
+    m_idle = true;
+    releaseRequests();
 }
 
 
@@ -181,16 +641,62 @@ void HttpConnection::deleteRequest() {
 }
 
 
+/**
+ * @brief Deletes requests which are answered
+ *
+ * Request is deleted when a newer request is read from the connection and no response
+ * of the request waits in the queue. Summary of the request is kept in the history
+ * for webStatus(), the history is limited to REQUEST_HISTORY_SIZE requests.
+ */
+void HttpConnection::releaseRequests() {
+    for (int i=m_requests.size()-1; i>=0; i--) {
+        HttpRequest *request = m_requests[i];
+        if (request == m_request) {
+            continue;
+            }
+
+        bool answered = true;
+        for (int r=0; r<m_responses.size(); r++) {
+            if (m_responses[r]->request() == request) {
+                answered = false;
+                break;
+                }
+            }
+        if (!answered) {
+            continue;
+            }
+
+        if (request == m_serviced) {
+            m_serviced = NULL;
+            }
+        m_history.append(requestSummary(request));
+        m_requests.removeAt(i);
+        HttpRequest::release(request);
+        m_parent->requestFinished();
+        }
+}
+
+
+QVariantMap HttpConnection::requestSummary(const HttpRequest *request) const {
+    QVariantMap data;
+    data["object"]      = QString("0x%1").arg((quint64)this, 8, 16, QChar('0'));
+    data["path"]        = (request!=NULL) ? request->path() : QVariant();
+    data["time"]        = (request!=NULL) ? request->datetime() : QVariant();
+    data["method"]      = (request!=NULL) ? request->method() : QVariant();
+    data["status"]      = (request!=NULL) ? request->statusString() : QVariant();
+    return data;
+}
+
+
 QVariant HttpConnection::webStatus() const {
     QVariantList list;
+    for (int i=m_history.firstIndex(); i<=m_history.lastIndex(); i++) {
+        QVariantMap data = m_history.at(i);
+        data["connection"]  = (isConnected()) ? "connected" : "disconnected";
+        list << data;
+        }
     for (int i=0; i<m_requests.size(); i++) {
-        const HttpRequest *request = m_requests[i];
-        QVariantMap data;
-        data["object"]      = QString("0x%1").arg((quint64)this, 8, 16, QChar('0'));
-        data["path"]        = (request!=NULL) ? request->path() : QVariant();
-        data["time"]        = (request!=NULL) ? request->datetime() : QVariant();
-        data["method"]      = (request!=NULL) ? request->method() : QVariant();
-        data["status"]      = (request!=NULL) ? request->statusString() : QVariant();
+        QVariantMap data = requestSummary(m_requests[i]);
         data["connection"]  = (isConnected()) ? "connected" : "disconnected";
         list << data;
         }
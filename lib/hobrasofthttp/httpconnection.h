@@ -14,6 +14,12 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QHostAddress>
+#include <QContiguousCache>
+#include <QVariantMap>
+#include <QElapsedTimer>
+#include "httptimerwheel.h"
+
+class HttpGZipStream;
 
 namespace HobrasoftHttpd {
 
@@ -106,18 +112,97 @@ class HttpConnection : public QObject {
      */
     bool isConnected() const { return m_connected; }
 
-    void setTimeout(int x) { m_timeout->setInterval(x); startTimeout(); }
+    /**
+     * @brief Stops reading requests from the socket
+     *
+     * Data stay in the socket, the socket read buffer is limited and TCP flow control
+     * slows down the client. Used by handlers which process streamed body.
+     *
+     * @see HttpRequestHandler::streamBody()
+     */
+    void pauseReading();
+
+    /**
+     * @brief Continues reading requests from the socket
+     */
+    void resumeReading();
+
+    /**
+     * @brief Returns true if reading from the socket is paused
+     */
+    bool isReadingPaused() const { return m_readingPaused; }
+
+    /**
+     * @brief Sets the timeout of the connection in milliseconds, zero disables the timeout
+     */
+    void setTimeout(int x) { m_timeoutInterval = x; startTimeout(); }
 
     /**
      * @brief Returns peer's host address
      */
     QHostAddress peerAddress() const { return m_peerAddress; }
 
-    HttpRequest *request() const { return m_request; }
+    /**
+     * @brief Returns the request being read or the last serviced request while it exists
+     */
+    HttpRequest *request() const { return (m_request != NULL) ? m_request : m_serviced; }
+
+    /**
+     * @brief Returns gzip stream used to compress chunks of current chunked response or NULL
+     *
+     * The stream is shared by all HttpResponse objects writing chunks of one
+     * response (HTML5 event streams use new HttpResponse for every event).
+     */
+    HttpGZipStream *gzipStream() const { return m_gzipStream; }
 
+    /**
+     * @brief Sets gzip stream of current chunked response, previous stream is deleted
+     */
+    void setGZipStream(HttpGZipStream *stream);
 
+    /**
+     * @brief Appends the response to the queue of responses waiting for the socket
+     *
+     * Called from the HttpResponse constructor. Responses to pipelined requests are
+     * written to the socket in the order of the requests. The response leaves the
+     * queue when it is destroyed.
+     */
+    void addResponse(HttpResponse *response);
+
+    /**
+     * @brief Returns true if the response can write to the socket
+     *
+     * The first response in the queue can write. Next responses can write when all
+     * responses before them let them, see HttpResponse::yieldsTo(). Chunks of an event
+     * stream are written in the order in which their responses were created.
+     */
+    bool isCurrentResponse(HttpResponse *response) const;
+
+    /**
+     * @brief Lets the response following the given one in the queue write its data
+     */
+    void writeNextResponse(HttpResponse *response);
+
+    /**
+     * @brief Marks the connection as carrying a chunked response
+     *
+     * Chunked response (HTML5 event stream) ends by closing the connection,
+     * pipelined requests are not serviced after it.
+     */
+    void setChunked(bool x) { m_chunked = x; }
+
+
+    /**
+     * @brief Returns summaries of recent and pending requests of the connection
+     */
     QVariant webStatus() const;
 
+  protected:
+    /**
+     * @brief Restarts timers when the connection moves to another thread
+     */
+    bool event(QEvent *);
+
   public slots:
     /**
      * @brief Closes the connection.
@@ -126,26 +211,68 @@ class HttpConnection : public QObject {
      */
     void close();
 
+    /**
+     * @brief Watches writing to the socket, called by HttpResponse after writing data
+     *
+     * The connection is aborted when the client does not read written data
+     * within the timeout.
+     */
+    void writeProgress();
+
   private slots:
     #ifndef DOXYGEN_SHOULD_SKIP_THIS
     void        slotTimeout();
+    void        slotWriteTimeout();
+    void        slotReadTimeout();
+    void        slotThreadChanged();
     void        slotRead();
     void        slotDisconnected();
+    void        slotResponseDestroyed(QObject *);
 
   private:
     void                 deleteRequest();
+    void                 finishRequest();
+    void                 releaseRequests();
+    bool                 admitRequest();
+    bool                 refuseOverloaded();
+    void                 reportBufferedBytes();
+    void                 readRequest();
+    void                 serviceRequests();
+    bool                 isReading() const;
+    bool                 isPipelineFull() const;
+    void                 resumePipeline();
+    void                 updateReadDeadlines();
+    QVariantMap          requestSummary(const HttpRequest *request) const;
     void                 startTimeout();
     QTcpSocket          *m_socket;
-    QTimer              *m_timeout;
+    HttpTimer            m_timeout;
+    HttpTimer            m_writeTimeout;
+    HttpTimer            m_headerTimeout;
+    HttpTimer            m_bodyTimeout;
+    QElapsedTimer        m_bodyClock;
+    qint64               m_bodyBytes;
+    int                  m_timeoutInterval;
     HttpRequest         *m_request;
+    HttpRequest         *m_serviced;
     QList<HttpRequest *> m_requests;
+    QList<HttpResponse *> m_responses;
+    QContiguousCache<QVariantMap> m_history;
+    QByteArray           m_buffer;
+    int                  m_bufferPos;
+    int                  m_bufferedBytes;
     HttpRequestHandler  *m_handler;
+    HttpGZipStream      *m_gzipStream;
     HttpServer          *m_parent;
     QSslCertificate      m_peerCertificate;
     QHostAddress         m_peerAddress;
     bool                 m_connected;
     bool                 m_inService;
     bool                 m_verified;
+    bool                 m_chunked;
+    bool                 m_closing;
+    bool                 m_readingPaused;
+    bool                 m_pipelineFull;
+    bool                 m_idle;
     #endif
     
 };
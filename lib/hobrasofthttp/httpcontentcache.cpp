@@ -0,0 +1,102 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "httpcontentcache.h"
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+using namespace HobrasoftHttpd;
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+struct CacheItem {
+    QByteArray  content;
+    QByteArray  digest;
+    QDateTime   lastModified;
+    qint64      size;
+};
+
+QMutex *cacheMutex() {
+    static QMutex mutex;
+    return &mutex;
+}
+
+QCache<QString, CacheItem> *cache() {
+    static QCache<QString, CacheItem> cache(16 * 1024 * 1024);
+    return &cache;
+}
+
+QString encodedKey(const QByteArray& digest, const QByteArray& encoding) {
+    return QString("e:%1:%2").arg(QString::fromLatin1(digest.toHex())).arg(QString::fromLatin1(encoding));
+}
+#endif
+
+}
+
+
+bool HttpContentCache::file(const QFileInfo& info, QByteArray *content, QByteArray *digest) {
+    QMutexLocker locker(cacheMutex());
+    const CacheItem *item = cache()->object("f:" + info.absoluteFilePath());
+    if (item == NULL) {
+        return false;
+        }
+
+    if (item->size != info.size() || item->lastModified != info.lastModified()) {
+        cache()->remove("f:" + info.absoluteFilePath());
+        return false;
+        }
+
+    *content = item->content;
+    *digest  = item->digest;
+    return true;
+}
+
+
+QByteArray HttpContentCache::insertFile(const QFileInfo& info, const QByteArray& content) {
+    CacheItem *item = new CacheItem;
+    item->content      = content;
+    item->digest       = QCryptographicHash::hash(content, QCryptographicHash::Md5);
+    item->lastModified = info.lastModified();
+    item->size         = info.size();
+    QByteArray digest  = item->digest;
+
+    QMutexLocker locker(cacheMutex());
+    cache()->insert("f:" + info.absoluteFilePath(), item, qMax(1, content.size()));
+    return digest;
+}
+
+
+bool HttpContentCache::encoded(const QByteArray& digest, const QByteArray& encoding, QByteArray *data) {
+    QMutexLocker locker(cacheMutex());
+    const CacheItem *item = cache()->object(encodedKey(digest, encoding));
+    if (item == NULL) {
+        return false;
+        }
+    *data = item->content;
+    return true;
+}
+
+
+void HttpContentCache::insertEncoded(const QByteArray& digest, const QByteArray& encoding, const QByteArray& data) {
+    CacheItem *item = new CacheItem;
+    item->content = data;
+    item->digest  = digest;
+    item->size    = data.size();
+
+    QMutexLocker locker(cacheMutex());
+    cache()->insert(encodedKey(digest, encoding), item, qMax(1, data.size()));
+}
+
+
+void HttpContentCache::setMaxSize(int bytes) {
+    QMutexLocker locker(cacheMutex());
+    cache()->setMaxCost(bytes);
+}
+
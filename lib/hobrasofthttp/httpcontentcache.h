@@ -0,0 +1,72 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#ifndef _HttpContentCache_H_
+#define _HttpContentCache_H_
+
+#include <QByteArray>
+#include <QString>
+#include <QFileInfo>
+
+namespace HobrasoftHttpd {
+
+/**
+ * @brief Cache of static contents and their compressed representations
+ *
+ * The cache is common for all connections and threads of the process.
+ *
+ * Files are stored under their path and they are revalidated against the file size
+ * and modification time on every lookup. Each stored file gets an MD5 digest of its content.
+ *
+ * Encoded representations (gzip compressed bodies) are stored under the digest of the
+ * identity content and the name of content coding. The same content is compressed
+ * only once even if it is served from different paths.
+ *
+ * Both parts of the cache share one limit given in bytes (HttpSettings::cacheSize()).
+ */
+class HttpContentCache {
+  public:
+
+    /**
+     * @brief Returns content of the file from cache
+     *
+     * @param info - current information about the file, used to check the stored content is not stale
+     * @param content - content of the file
+     * @param digest - MD5 digest of the content
+     * @returns false if the file is not in the cache or the cached content is stale
+     */
+    static bool file(const QFileInfo& info, QByteArray *content, QByteArray *digest);
+
+    /**
+     * @brief Stores content of the file to cache, returns MD5 digest of the content
+     */
+    static QByteArray insertFile(const QFileInfo& info, const QByteArray& content);
+
+    /**
+     * @brief Returns encoded representation of content with given digest
+     *
+     * @param digest - digest of the identity content
+     * @param encoding - name of the content coding (gzip)
+     * @param data - encoded representation
+     * @returns false if the representation is not cached
+     */
+    static bool encoded(const QByteArray& digest, const QByteArray& encoding, QByteArray *data);
+
+    /**
+     * @brief Stores encoded representation of content with given digest
+     */
+    static void insertEncoded(const QByteArray& digest, const QByteArray& encoding, const QByteArray& data);
+
+    /**
+     * @brief Sets the maximal size of the cache in bytes, zero disables the cache
+     */
+    static void setMaxSize(int bytes);
+
+};
+
+}
+
+#endif
@@ -0,0 +1,269 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "httpcontentencoding.h"
+#include "httpgzipcompression.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+
+#ifdef HOBRASOFTHTTPD_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#ifdef HOBRASOFTHTTPD_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace HobrasoftHttpd;
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+class GzipEncoder : public HttpContentEncoder {
+  public:
+    QByteArray name() const { return "gzip"; }
+    QString suffix() const { return ".gz"; }
+    int maxLevel() const { return HttpGZipCompression::BestCompression; }
+    QByteArray encode(const QByteArray& data, int level) const {
+        return HttpGZipCompression::compressData(data, level);
+    }
+};
+
+
+#ifdef HOBRASOFTHTTPD_BROTLI
+class BrotliEncoder : public HttpContentEncoder {
+  public:
+    QByteArray name() const { return "br"; }
+    QString suffix() const { return ".br"; }
+    int maxLevel() const { return BROTLI_MAX_QUALITY; }
+    QByteArray encode(const QByteArray& data, int level) const {
+        // Quality 5 is a good compromise between the speed and ratio for compression on request
+        int quality = (level < 0) ? 5 : level;
+        size_t size = BrotliEncoderMaxCompressedSize(data.size());
+        QByteArray output;
+        output.resize(size);
+        if (!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                                   data.size(), reinterpret_cast<const uint8_t *>(data.constData()),
+                                   &size, reinterpret_cast<uint8_t *>(output.data()))) {
+            return QByteArray();
+            }
+        output.resize(size);
+        return output;
+    }
+};
+#endif
+
+
+#ifdef HOBRASOFTHTTPD_ZSTD
+class ZstdEncoder : public HttpContentEncoder {
+  public:
+    QByteArray name() const { return "zstd"; }
+    QString suffix() const { return ".zst"; }
+    int maxLevel() const { return 19; }
+    QByteArray encode(const QByteArray& data, int level) const {
+        int clevel = (level < 0) ? 3 : level;
+        QByteArray output;
+        output.resize(ZSTD_compressBound(data.size()));
+        size_t size = ZSTD_compress(output.data(), output.size(), data.constData(), data.size(), clevel);
+        if (ZSTD_isError(size)) {
+            return QByteArray();
+            }
+        output.resize(size);
+        return output;
+    }
+};
+#endif
+
+
+struct Registry {
+    QMutex                              mutex;
+    QList<const HttpContentEncoder *>   encoders;
+
+    Registry() {
+        #ifdef HOBRASOFTHTTPD_BROTLI
+        encoders << new BrotliEncoder;
+        #endif
+        #ifdef HOBRASOFTHTTPD_ZSTD
+        encoders << new ZstdEncoder;
+        #endif
+        encoders << new GzipEncoder;
+    }
+};
+
+
+Registry *registry() {
+    static Registry registry;
+    return &registry;
+}
+#endif
+
+}
+
+
+void HttpContentEncoding::addEncoder(HttpContentEncoder *encoder) {
+    QMutexLocker locker(&registry()->mutex);
+    registry()->encoders << encoder;
+}
+
+
+QList<const HttpContentEncoder *> HttpContentEncoding::encoders() {
+    QMutexLocker locker(&registry()->mutex);
+    return registry()->encoders;
+}
+
+
+const HttpContentEncoder *HttpContentEncoding::encoder(const QByteArray& name) {
+    QList<const HttpContentEncoder *> list = encoders();
+    for (int i=0; i<list.size(); i++) {
+        if (list[i]->name() == name) {
+            return list[i];
+            }
+        }
+    return NULL;
+}
+
+
+double HttpContentEncoding::quality(const QString& acceptEncoding, const QByteArray& name) {
+    bool   found = false;
+    double q     = 0;
+    bool   foundStar = false;
+    double qStar     = 0;
+
+    QStringList items = acceptEncoding.split(',');
+    for (int i=0; i<items.size(); i++) {
+        QStringList params = items[i].split(';');
+        QString coding = params[0].trimmed();
+        if (coding.isEmpty()) {
+            continue;
+            }
+
+        double value = 1;
+        for (int p=1; p<params.size(); p++) {
+            QString param = params[p].trimmed();
+            if (param.startsWith("q=", Qt::CaseInsensitive)) {
+                bool ok;
+                value = param.mid(2).toDouble(&ok);
+                if (!ok) { value = 0; }
+                }
+            }
+
+        if (coding == "*") {
+            foundStar = true;
+            qStar = value;
+            continue;
+            }
+
+        if (coding.compare(QString::fromLatin1(name), Qt::CaseInsensitive) == 0) {
+            found = true;
+            q = value;
+            }
+        }
+
+    if (found)     { return q; }
+    if (foundStar) { return qStar; }
+    if (name == "identity") {
+        // Identity is always acceptable unless refused, but less than any listed coding
+        return 0.001;
+        }
+    return 0;
+}
+
+
+QByteArray HttpContentEncoding::negotiate(const QString& acceptEncoding, const QList<QByteArray>& available) {
+    if (acceptEncoding.isEmpty()) {
+        return QByteArray();
+        }
+
+    QList<const HttpContentEncoder *> list = encoders();
+    QByteArray best;
+    double     bestq = 0;
+    for (int i=0; i<list.size(); i++) {
+        QByteArray name = list[i]->name();
+        if (!available.isEmpty() && !available.contains(name)) {
+            continue;
+            }
+        double q = quality(acceptEncoding, name);
+        if (q > bestq) {
+            best  = name;
+            bestq = q;
+            }
+        }
+
+    if (bestq <= 0 || bestq < quality(acceptEncoding, "identity")) {
+        return QByteArray();
+        }
+    return best;
+}
+
+
+QByteArray HttpContentEncoding::entityTag(const QByteArray& etag, const QByteArray& encoding) {
+    if (encoding.isEmpty() || !etag.endsWith('"')) {
+        return etag;
+        }
+    QByteArray tag = etag;
+    tag.insert(tag.size() - 1, "-" + encoding);
+    return tag;
+}
+
+
+QByteArray HttpContentEncoding::identityEntityTag(const QByteArray& etag) {
+    if (!etag.endsWith('"')) {
+        return etag;
+        }
+    QList<const HttpContentEncoder *> list = encoders();
+    for (int i=0; i<list.size(); i++) {
+        QByteArray suffix = "-" + list[i]->name() + "\"";
+        if (etag.endsWith(suffix)) {
+            return etag.left(etag.size() - suffix.size()) + '"';
+            }
+        }
+    return etag;
+}
+
+
+bool HttpContentEncoding::writePrecompressed(const QString& path) {
+    QFileInfo info(path);
+    QByteArray data;
+    bool ok = true;
+    QList<const HttpContentEncoder *> list = encoders();
+    for (int i=0; i<list.size(); i++) {
+        QString encodedPath = path + list[i]->suffix();
+        QFileInfo encodedInfo(encodedPath);
+        if (encodedInfo.exists() && encodedInfo.lastModified() >= info.lastModified()) {
+            continue;
+            }
+
+        if (data.isNull()) {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly)) {
+                qWarning("HttpContentEncoding: cannot read %s", qPrintable(path));
+                return false;
+                }
+            data = file.readAll();
+            }
+
+        QByteArray encoded = list[i]->encode(data, list[i]->maxLevel());
+        if (encoded.isEmpty()) {
+            qWarning("HttpContentEncoding: cannot compress %s with %s", qPrintable(path), list[i]->name().constData());
+            ok = false;
+            continue;
+            }
+
+        QSaveFile file(encodedPath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(encoded) != encoded.size() || !file.commit()) {
+            qWarning("HttpContentEncoding: cannot write %s", qPrintable(encodedPath));
+            ok = false;
+            continue;
+            }
+        }
+    return ok;
+}
+
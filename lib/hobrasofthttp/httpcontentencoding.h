@@ -0,0 +1,121 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#ifndef _HttpContentEncoding_H_
+#define _HttpContentEncoding_H_
+
+#include <QByteArray>
+#include <QString>
+#include <QList>
+
+namespace HobrasoftHttpd {
+
+/**
+ * @brief Encoder of one content coding (gzip, br, zstd)
+ *
+ * Derive your own class and register it with HttpContentEncoding::addEncoder()
+ * to support another content coding.
+ */
+class HttpContentEncoder {
+  public:
+    virtual ~HttpContentEncoder() {}
+
+    /**
+     * @brief Returns the name of content coding used in Accept-Encoding and Content-Encoding headers
+     */
+    virtual QByteArray name() const = 0;
+
+    /**
+     * @brief Returns the suffix of precompressed files (.gz)
+     */
+    virtual QString suffix() const = 0;
+
+    /**
+     * @brief Returns the best compression level of the encoder
+     */
+    virtual int maxLevel() const = 0;
+
+    /**
+     * @brief Returns encoded data, -1 is the default level suitable for compression on request
+     */
+    virtual QByteArray encode(const QByteArray& data, int level = -1) const = 0;
+};
+
+
+/**
+ * @brief Registry of content encoders and Accept-Encoding negotiation
+ *
+ * The gzip encoder is always available. Brotli (br) and zstd encoders are built in when
+ * the library is compiled with HOBRASOFTHTTPD_BROTLI or HOBRASOFTHTTPD_ZSTD defined.
+ *
+ * Encoders are preferred in the order of registration when the client accepts
+ * more of them with the same quality. Built-in encoders are registered in the order br, zstd, gzip.
+ */
+class HttpContentEncoding {
+  public:
+
+    /**
+     * @brief Registers new encoder, the registry takes the ownership of the encoder
+     */
+    static void addEncoder(HttpContentEncoder *encoder);
+
+    /**
+     * @brief Returns encoder of given content coding or NULL
+     */
+    static const HttpContentEncoder *encoder(const QByteArray& name);
+
+    /**
+     * @brief Returns all registered encoders in the order of preference
+     */
+    static QList<const HttpContentEncoder *> encoders();
+
+    /**
+     * @brief Returns quality value of the content coding in Accept-Encoding header
+     *
+     * Values of the coding, then of "*" are used. Zero is returned if the coding is not acceptable.
+     * Identity is acceptable unless it is explicitly refused.
+     */
+    static double quality(const QString& acceptEncoding, const QByteArray& name);
+
+    /**
+     * @brief Returns entity tag of the encoded representation ("abc" to "abc-gzip")
+     *
+     * Strong entity tag must differ for each representation of the content.
+     * The tag is returned unchanged when the encoding is empty.
+     */
+    static QByteArray entityTag(const QByteArray& etag, const QByteArray& encoding);
+
+    /**
+     * @brief Returns entity tag of the identity representation, removes the suffix added by entityTag()
+     */
+    static QByteArray identityEntityTag(const QByteArray& etag);
+
+    /**
+     * @brief Selects the best content coding acceptable by the client
+     *
+     * @param acceptEncoding - value of the Accept-Encoding header
+     * @param available - names of content codings available for the response,
+     *                    all registered encoders are used when the list is empty
+     * @returns the name of the selected coding or empty QByteArray when the identity should be sent
+     */
+    static QByteArray negotiate(const QString& acceptEncoding, const QList<QByteArray>& available = QList<QByteArray>());
+
+    /**
+     * @brief Writes precompressed copies of the file for all registered encoders (app.js.gz, app.js.br...)
+     *
+     * The copies are compressed with the best level of each encoder, they are sent as they are
+     * instead of compressing the file on each request. Copies newer than the file are kept.
+     * The best levels are slow, do not call the method from the GUI thread.
+     *
+     * @returns false if any copy could not be written
+     */
+    static bool writePrecompressed(const QString& path);
+
+};
+
+}
+
+#endif
@@ -3,46 +3,191 @@
  * @author Sergey Alikin alikin.sergey@gmail.com
  */
 #include "httpgzipcompression.h"
-#include <QDataStream>
+#include <QtEndian>
+#include <zlib.h>
 
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+const int GZIP_HEADER_SIZE = 10;
+const int GZIP_FOOTER_SIZE = 8;
+
+/**
+ * @brief Tables for slicing-by-8 CRC32, the first table is crc_32_tab
+ */
+struct Crc32Tables {
+    quint32 table[8][256];
+
+    Crc32Tables() {
+        for (int i=0; i<256; i++) {
+            table[0][i] = crc_32_tab[i];
+            }
+        for (int i=0; i<256; i++) {
+            for (int k=1; k<8; k++) {
+                table[k][i] = (table[k-1][i] >> 8) ^ table[0][table[k-1][i] & 0xff];
+                }
+            }
+    }
+};
+
+const Crc32Tables& crc32Tables() {
+    static const Crc32Tables tables;
+    return tables;
+}
+#endif
 
-QByteArray HttpGZipCompression::compressData(const QByteArray &data) {
-    return header() + compress(data) + footer(data);
 }
 
 
-QByteArray HttpGZipCompression::header() {
-    return QByteArray::fromHex("1f8b080000000000000b");
+/**
+ * @brief Returns data compressed to gzip format
+ *
+ * @param level - compression level 0 to 9, -1 uses default compression level
+ */
+QByteArray HttpGZipCompression::compressData(const QByteArray &data, int level) {
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree  = Z_NULL;
+    stream.opaque = Z_NULL;
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+        }
+
+    // The bound is large enough to compress everything in one deflate() call
+    int bound = deflateBound(&stream, data.size());
+    QByteArray output;
+    output.resize(GZIP_HEADER_SIZE + bound + GZIP_FOOTER_SIZE);
+    writeHeader(output.data(), level);
+
+    stream.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in  = data.size();
+    stream.next_out  = reinterpret_cast<Bytef *>(output.data() + GZIP_HEADER_SIZE);
+    stream.avail_out = bound;
+    int rc = deflate(&stream, Z_FINISH);
+    int compressedSize = bound - stream.avail_out;
+    deflateEnd(&stream);
+    if (rc != Z_STREAM_END) {
+        return QByteArray();
+        }
+
+    writeFooter(output.data() + GZIP_HEADER_SIZE + compressedSize, crc32(data.constData(), data.size()), data.size());
+    output.resize(GZIP_HEADER_SIZE + compressedSize + GZIP_FOOTER_SIZE);
+    return output;
 }
 
 
-QByteArray HttpGZipCompression::compress(const QByteArray &sourceData) {
-    QByteArray compressedData = qCompress(sourceData);
-    compressedData.remove(0, 6);
-    compressedData.chop(4);
-    return compressedData;
+void HttpGZipCompression::writeHeader(char *buffer, int level) {
+    static const char header[GZIP_HEADER_SIZE] = { '\x1f', '\x8b', '\x08', 0, 0, 0, 0, 0, 0, '\x0b' };
+    memcpy(buffer, header, GZIP_HEADER_SIZE);
+    // XFL: 2 - maximum compression, 4 - fastest algorithm
+    buffer[8] = (level == BestCompression) ? 2 : (level == BestSpeed) ? 4 : 0;
 }
 
 
-QByteArray HttpGZipCompression::footer(const QByteArray &sourceData) {
-    QByteArray footer;
-    QDataStream footerStream(&footer, QIODevice::WriteOnly);
-    footerStream.setByteOrder(QDataStream::LittleEndian);
-    footerStream << crc32(sourceData) << quint32(sourceData.size());
-    return footer;
+void HttpGZipCompression::writeFooter(char *buffer, quint32 crc, quint32 size) {
+    qToLittleEndian<quint32>(crc,  reinterpret_cast<uchar *>(buffer));
+    qToLittleEndian<quint32>(size, reinterpret_cast<uchar *>(buffer + 4));
 }
 
 
-quint32 HttpGZipCompression::updateCRC32(unsigned char ch, quint32 crc) {
-    return (crc_32_tab[((crc) ^ ((quint8)ch)) & 0xff] ^ ((crc) >> 8));
+quint32 HttpGZipCompression::crc32(const char *data, qint64 size, quint32 crc) {
+    const quint32 (&table)[8][256] = crc32Tables().table;
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    crc = ~crc;
+
+    while (size >= 8) {
+        quint32 one = qFromLittleEndian<quint32>(p) ^ crc;
+        quint32 two = qFromLittleEndian<quint32>(p + 4);
+        crc = table[7][ one        & 0xff] ^
+              table[6][(one >>  8) & 0xff] ^
+              table[5][(one >> 16) & 0xff] ^
+              table[4][ one >> 24        ] ^
+              table[3][ two        & 0xff] ^
+              table[2][(two >>  8) & 0xff] ^
+              table[1][(two >> 16) & 0xff] ^
+              table[0][ two >> 24        ];
+        p    += 8;
+        size -= 8;
+        }
+
+    while (size-- > 0) {
+        crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        }
+
+    return ~crc;
 }
 
 
-quint32 HttpGZipCompression::crc32(const QByteArray& data) {
-    quint32 crc = 0xFFFFFFFF;
-    for (int i=0; i<data.size(); i++) {
-        crc = updateCRC32(data[i], crc);
+HttpGZipStream::~HttpGZipStream() {
+    if (m_valid) {
+        deflateEnd(m_stream);
         }
-    return crc;
+    delete m_stream;
 }
 
+
+HttpGZipStream::HttpGZipStream(int level) {
+    m_level = level;
+    m_crc = 0;
+    m_size = 0;
+    m_headerWritten = false;
+    m_finished = false;
+    m_stream = new z_stream;
+    m_stream->zalloc = Z_NULL;
+    m_stream->zfree  = Z_NULL;
+    m_stream->opaque = Z_NULL;
+    m_valid = (deflateInit2(m_stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+}
+
+
+QByteArray HttpGZipStream::compress(const QByteArray &data) {
+    if (!m_valid || m_finished) {
+        return QByteArray();
+        }
+    m_crc   = HttpGZipCompression::crc32(data.constData(), data.size(), m_crc);
+    m_size += data.size();
+    return deflate(data, Z_SYNC_FLUSH);
+}
+
+
+QByteArray HttpGZipStream::finish() {
+    if (!m_valid || m_finished) {
+        return QByteArray();
+        }
+    QByteArray output = deflate(QByteArray(), Z_FINISH);
+    m_finished = true;
+    int size = output.size();
+    output.resize(size + GZIP_FOOTER_SIZE);
+    HttpGZipCompression::writeFooter(output.data() + size, m_crc, m_size);
+    return output;
+}
+
+
+/**
+ * @brief Runs deflate until all input is consumed and the flush is complete
+ */
+QByteArray HttpGZipStream::deflate(const QByteArray &data, int flush) {
+    QByteArray output;
+    int size = 0;
+    if (!m_headerWritten) {
+        output.resize(GZIP_HEADER_SIZE);
+        HttpGZipCompression::writeHeader(output.data(), m_level);
+        size = GZIP_HEADER_SIZE;
+        m_headerWritten = true;
+        }
+
+    m_stream->next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    m_stream->avail_in = data.size();
+    int rc;
+    do {
+        int room = data.size() / 2 + 64;
+        output.resize(size + room);
+        m_stream->next_out  = reinterpret_cast<Bytef *>(output.data() + size);
+        m_stream->avail_out = room;
+        rc = ::deflate(m_stream, flush);
+        size += room - m_stream->avail_out;
+        } while (rc == Z_OK && m_stream->avail_out == 0);
+
+    output.resize(size);
+    return output;
+}
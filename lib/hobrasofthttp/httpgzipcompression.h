@@ -54,20 +54,82 @@ static const quint32 crc_32_tab[] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+/**
+ * @brief Compresses data to gzip format (RFC 1952)
+ *
+ * Data are compressed with raw deflate directly to the output buffer between
+ * the gzip header and trailer. The CRC32 of the trailer is computed
+ * eight bytes at a time (slicing-by-8).
+ */
 class HttpGZipCompression : public QObject
 {
     Q_OBJECT
 
     public:
+        /**
+         * @brief Compression levels, any level between 0 and 9 can be used too
+         */
+        enum CompressionLevel {
+            DefaultCompression = -1,    ///< Default zlib compression level (6)
+            NoCompression = 0,          ///< Stored blocks only
+            BestSpeed = 1,              ///< Fastest compression
+            BestCompression = 9         ///< Smallest output, used for precompressed files
+            };
+
         explicit HttpGZipCompression(QObject * = NULL) {}
-        static QByteArray compressData(const QByteArray &data);
+        static QByteArray compressData(const QByteArray &data, int level = DefaultCompression);
+
+        /**
+         * @brief Updates CRC32 with the data, the initial value of crc is 0
+         */
+        static quint32 crc32(const char *data, qint64 size, quint32 crc = 0);
+
+    private:
+        friend class HttpGZipStream;
+        static void writeHeader(char *buffer, int level);
+        static void writeFooter(char *buffer, quint32 crc, quint32 size);
+};
+
+
+/**
+ * @brief Incremental gzip compression of a stream sent in more parts (chunked responses)
+ *
+ * Every part is flushed with Z_SYNC_FLUSH so the client can decompress it
+ * as soon as it arrives. The gzip header is returned with the first part,
+ * the last deflate block and the gzip trailer are returned from finish().
+ */
+class HttpGZipStream
+{
+    public:
+       ~HttpGZipStream();
+        explicit HttpGZipStream(int level = HttpGZipCompression::DefaultCompression);
+
+        /**
+         * @brief Compresses next part of the stream
+         */
+        QByteArray compress(const QByteArray &data);
+
+        /**
+         * @brief Ends the stream, returns the rest of compressed data and the trailer
+         */
+        QByteArray finish();
+
+        /**
+         * @brief Returns true if the finish() was called already
+         */
+        bool isFinished() const { return m_finished; }
 
     private:
-        static QByteArray header();
-        static QByteArray compress(const QByteArray &sourceData);
-        static QByteArray footer(const QByteArray &sourceData);
-        static quint32 crc32(const QByteArray &data);
-        static quint32 updateCRC32(unsigned char ch, quint32 crc);
+        #ifndef DOXYGEN_SHOULD_SKIP_THIS
+        QByteArray deflate(const QByteArray &data, int flush);
+        struct z_stream_s  *m_stream;
+        int                 m_level;
+        quint32             m_crc;
+        quint32             m_size;
+        bool                m_headerWritten;
+        bool                m_finished;
+        bool                m_valid;
+        #endif
 };
 
 #endif // HTTPGZIPCOMPRESSION_H
@@ -0,0 +1,215 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "httpmultipartparser.h"
+#include <QDebug>
+#include <string.h>
+
+using namespace HobrasoftHttpd;
+
+
+HttpMultiPartParser::~HttpMultiPartParser() {
+    delete m_file;
+    qDeleteAll(m_uploadedFiles);
+}
+
+
+HttpMultiPartParser::HttpMultiPartParser(const QByteArray& boundary) {
+    m_state = StatePreamble;
+    m_delimiter = "\r\n--" + boundary;
+    m_matcher.setPattern(m_delimiter);
+    m_pos = 0;
+    m_file = NULL;
+
+    // The first boundary is not preceded by a line break
+    m_buffer = "\r\n";
+}
+
+
+void HttpMultiPartParser::write(const char *data, int size) {
+    if (m_state == StateFinished) { return; }
+    m_buffer.append(data, size);
+
+    bool progress = true;
+    while (progress) {
+        switch (m_state) {
+            case StatePreamble:
+            case StateData:
+                progress = parseData();
+                break;
+            case StateDelimiter:
+                progress = parseDelimiter();
+                break;
+            case StateHeaders:
+                progress = parseHeaders();
+                break;
+            case StateFinished:
+                progress = false;
+                break;
+            }
+        }
+
+    // Parsed data are removed, only an incomplete line or a possible beginning of the boundary stays
+    if (m_state == StateFinished) {
+        m_buffer.clear();
+        m_pos = 0;
+        return;
+        }
+    m_buffer.remove(0, m_pos);
+    m_pos = 0;
+}
+
+
+QMap<QString, QTemporaryFile *> HttpMultiPartParser::takeUploadedFiles() {
+    QMap<QString, QTemporaryFile *> files = m_uploadedFiles;
+    m_uploadedFiles.clear();
+    return files;
+}
+
+
+/**
+ * @brief Searches the boundary, data before the boundary belong to the current part
+ */
+bool HttpMultiPartParser::parseData() {
+    int index = m_matcher.indexIn(m_buffer, m_pos);
+    if (index < 0) {
+        // The end of buffer could contain the beginning of the boundary
+        int safe = m_buffer.size() - m_delimiter.size() + 1;
+        if (safe > m_pos) {
+            if (m_state == StateData) {
+                writePart(m_buffer.constData() + m_pos, safe - m_pos);
+                }
+            m_pos = safe;
+            }
+        return false;
+        }
+
+    if (m_state == StateData) {
+        writePart(m_buffer.constData() + m_pos, index - m_pos);
+        finishPart();
+        }
+    m_pos = index + m_delimiter.size();
+    m_state = StateDelimiter;
+    return true;
+}
+
+
+/**
+ * @brief Reads the rest of the boundary line, "--" marks the closing boundary
+ */
+bool HttpMultiPartParser::parseDelimiter() {
+    if (m_buffer.size() - m_pos < 2) {
+        return false;
+        }
+
+    if (m_buffer.at(m_pos) == '-' && m_buffer.at(m_pos+1) == '-') {
+        m_state = StateFinished;
+        return false;
+        }
+
+    const char *newline = static_cast<const char *>(memchr(m_buffer.constData() + m_pos, '\n', m_buffer.size() - m_pos));
+    if (newline == NULL) {
+        return false;
+        }
+
+    m_pos = newline - m_buffer.constData() + 1;
+    m_fieldName.clear();
+    m_fileName.clear();
+    m_contentType.clear();
+    m_state = StateHeaders;
+    return true;
+}
+
+
+/**
+ * @brief Reads the headers of one part
+ */
+bool HttpMultiPartParser::parseHeaders() {
+    while (true) {
+        const char *newline = static_cast<const char *>(memchr(m_buffer.constData() + m_pos, '\n', m_buffer.size() - m_pos));
+        if (newline == NULL) {
+            return false;
+            }
+
+        int end = newline - m_buffer.constData();
+        QString line = QString::fromUtf8(m_buffer.constData() + m_pos, end - m_pos).trimmed();
+        m_pos = end + 1;
+
+        if (line.isEmpty()) {
+            m_state = StateData;
+            return true;
+            }
+
+        if (line.startsWith("Content-Disposition:", Qt::CaseInsensitive)) {
+            if (line.contains("form-data", Qt::CaseInsensitive)) {
+                int start=line.indexOf(" name=\"", 0, Qt::CaseInsensitive);
+                int end=line.indexOf("\"",start+7);
+                if (start>=0 && end>=start) {
+                    m_fieldName=line.mid(start+7,end-start-7);
+                    }
+                start=line.indexOf(" filename=\"", 0, Qt::CaseInsensitive);
+                end=line.indexOf("\"",start+11);
+                if (start>=0 && end>=start) {
+                    m_fileName=line.mid(start+11,end-start-11);
+                    }
+                }
+            continue;
+            }
+
+        if (line.startsWith("Content-Type:", Qt::CaseInsensitive)) {
+            m_contentType = line.mid(13).trimmed();
+            continue;
+            }
+
+        qDebug() << "HttpMultiPartParser: ignoring unsupported content part" << line;
+        }
+}
+
+
+void HttpMultiPartParser::writePart(const char *data, int size) {
+    if (size <= 0 || m_fieldName.isEmpty()) {
+        return;
+        }
+
+    if (m_fileName.isEmpty()) {
+        m_fieldValue.append(data, size);
+        return;
+        }
+
+    if (m_file == NULL) {
+        m_file = new QTemporaryFile();
+        m_file->open();
+        }
+    m_file->write(data, size);
+    if (m_file->error()) {
+        qCritical("HttpMultiPartParser: error writing temp file, %s", qPrintable(m_file->errorString()));
+        }
+}
+
+
+void HttpMultiPartParser::finishPart() {
+    if (!m_fieldName.isEmpty() && m_fileName.isEmpty()) {
+        m_parameters.insert(m_fieldName, QString::fromUtf8(m_fieldValue));
+        }
+
+    if (!m_fieldName.isEmpty() && !m_fileName.isEmpty()) {
+        if (m_file == NULL) {
+            // Empty file
+            m_file = new QTemporaryFile();
+            m_file->open();
+            }
+        m_file->flush();
+        m_file->seek(0);
+        m_parameters.insert(m_fieldName, m_fileName);
+        delete m_uploadedFiles.value(m_fieldName);
+        m_uploadedFiles.insert(m_fieldName, m_file);
+        m_contentTypes.insert(m_fieldName, m_contentType);
+        m_file = NULL;
+        }
+
+    m_fieldValue.clear();
+}
+
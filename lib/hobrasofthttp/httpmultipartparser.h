@@ -0,0 +1,101 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#ifndef _HttpMultiPartParser_H_
+#define _HttpMultiPartParser_H_
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QString>
+#include <QMap>
+#include <QMultiMap>
+#include <QTemporaryFile>
+
+namespace HobrasoftHttpd {
+
+/**
+ * @brief Streaming parser of multipart/form-data request body
+ *
+ * The body is parsed in one pass as it arrives from the network. Boundaries are
+ * searched with QByteArrayMatcher (Boyer-Moore). Form fields are collected in memory,
+ * uploaded files are written directly to their own temporary files. Only the tail
+ * of the data which could contain a part of the boundary is kept between calls.
+ */
+class HttpMultiPartParser {
+  public:
+   ~HttpMultiPartParser();
+
+    /**
+     * @brief Constructor
+     *
+     * @param boundary - boundary from the Content-Type header of the request
+     */
+    HttpMultiPartParser(const QByteArray& boundary);
+
+    /**
+     * @brief Parses next part of the body
+     */
+    void write(const char *data, int size);
+
+    /**
+     * @brief Returns true if the closing boundary was found
+     */
+    bool isFinished() const { return m_state == StateFinished; }
+
+    /**
+     * @brief Returns values of form fields and names of uploaded files
+     */
+    const QMultiMap<QString, QString>& parameters() const { return m_parameters; }
+
+    /**
+     * @brief Returns uploaded files, the caller takes ownership of the files
+     *
+     * Files are opened and positioned at the beginning. The parser forgets the files.
+     */
+    QMap<QString, QTemporaryFile *> takeUploadedFiles();
+
+    /**
+     * @brief Returns content types of uploaded files
+     */
+    const QMap<QString, QString>& contentTypes() const { return m_contentTypes; }
+
+  private:
+    #ifndef DOXYGEN_SHOULD_SKIP_THIS
+    enum State {
+        StatePreamble,
+        StateDelimiter,
+        StateHeaders,
+        StateData,
+        StateFinished
+        };
+
+    bool    parseDelimiter();
+    bool    parseHeaders();
+    bool    parseData();
+    void    writePart(const char *data, int size);
+    void    finishPart();
+
+    State                               m_state;
+    QByteArray                          m_delimiter;
+    QByteArrayMatcher                   m_matcher;
+    QByteArray                          m_buffer;
+    int                                 m_pos;
+
+    QString                             m_fieldName;
+    QString                             m_fileName;
+    QString                             m_contentType;
+    QByteArray                          m_fieldValue;
+    QTemporaryFile                     *m_file;
+
+    QMultiMap<QString, QString>         m_parameters;
+    QMap<QString, QTemporaryFile *>     m_uploadedFiles;
+    QMap<QString, QString>              m_contentTypes;
+    #endif
+};
+
+}
+
+#endif
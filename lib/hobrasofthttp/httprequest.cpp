@@ -8,200 +8,493 @@
 #include "httprequest.h"
 #include "httpconnection.h"
 #include "httpsettings.h"
+#include "httpmultipartparser.h"
 #include <QList>
+#include <QThreadStorage>
 #include <QDir>
-#include <QMapIterator>
 #include <QDebug>
+#include <string.h>
 
 using namespace HobrasoftHttpd;
 
+/**
+ * @brief Maximum number of released requests kept in the pool of one thread
+ */
+#define REQUEST_POOL_SIZE 64
+
+/**
+ * @brief Number of header fields allocated in advance
+ */
+#define REQUEST_FIELDS_SIZE 16
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+struct KnownHeaderName {
+    const char                 *name;
+    int                         length;
+    HttpRequest::KnownHeader    id;
+};
+
+const KnownHeaderName knownHeaderNames[] = {
+    { "Host",               4,  HttpRequest::HeaderHost },
+    { "Connection",         10, HttpRequest::HeaderConnection },
+    { "Content-Type",       12, HttpRequest::HeaderContentType },
+    { "Content-Length",     14, HttpRequest::HeaderContentLength },
+    { "Accept-Encoding",    15, HttpRequest::HeaderAcceptEncoding },
+    { "Cookie",             6,  HttpRequest::HeaderCookie },
+    { "Expect",             6,  HttpRequest::HeaderExpect },
+    { "Range",              5,  HttpRequest::HeaderRange },
+    { "If-Range",           8,  HttpRequest::HeaderIfRange },
+    { "If-None-Match",      13, HttpRequest::HeaderIfNoneMatch },
+    { "If-Modified-Since",  17, HttpRequest::HeaderIfModifiedSince },
+};
+
+inline int hexValue(char c) {
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+}
+
+inline char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/*
+ * Case insensitive FNV-1a hash of the header name
+ */
+uint nameHash(const char *name, int length) {
+    uint hash = 2166136261u;
+    for (int i=0; i<length; i++) {
+        hash = (hash ^ (uchar)lower(name[i])) * 16777619u;
+        }
+    return hash;
+}
+
+/*
+ * The same hash computed from QString, characters out of Latin1 never match a header name
+ */
+uint nameHash(const QString& name) {
+    uint hash = 2166136261u;
+    for (int i=0; i<name.size(); i++) {
+        hash = (hash ^ (uchar)lower(name[i].toLatin1())) * 16777619u;
+        }
+    return hash;
+}
+
+/*
+ * Released requests of one thread, deleted when the thread finishes
+ */
+struct RequestPool {
+    QList<HttpRequest *> requests;
+   ~RequestPool() { qDeleteAll(requests); }
+};
+
+QThreadStorage<RequestPool *> requestPools;
+
+RequestPool *requestPool() {
+    if (!requestPools.hasLocalData()) {
+        requestPools.setLocalData(new RequestPool);
+        }
+    return requestPools.localData();
+}
+#endif
+
+}
+
+
+HttpRequest::~HttpRequest() {
+    delete m_multiPart;
+    qDeleteAll(m_uploadedFiles);
+}
+
 
 HttpRequest::HttpRequest(HttpConnection *parent) {
+    m_multiPart = NULL;
+    m_fields.reserve(REQUEST_FIELDS_SIZE);
+    reset(parent);
+}
+
+
+HttpRequest *HttpRequest::create(HttpConnection *connection) {
+    RequestPool *pool = requestPool();
+    if (pool->requests.isEmpty()) {
+        return new HttpRequest(connection);
+        }
+    HttpRequest *request = pool->requests.takeLast();
+    request->reset(connection);
+    return request;
+}
+
+
+void HttpRequest::release(HttpRequest *request) {
+    if (request == NULL) { return; }
+    RequestPool *pool = requestPool();
+    if (pool->requests.size() >= REQUEST_POOL_SIZE) {
+        delete request;
+        return;
+        }
+
+    // Files, multipart parser and body are released at once, the pooled request keeps only its buffers
+    request->reset(NULL);
+    pool->requests << request;
+}
+
+
+void HttpRequest::reset(HttpConnection *parent) {
+    delete m_multiPart;
+    m_multiPart = NULL;
+    qDeleteAll(m_uploadedFiles);
+    m_uploadedFiles.clear();
+    m_contentTypes.clear();
+    m_parameters.clear();
+    m_cookies.clear();
+    m_decodedPath.clear();
+    m_bodyData.clear();
+    m_method.clear();
+    m_path.clear();
+    m_query.clear();
+    m_fullpath.clear();
+    m_version.clear();
+    m_boundary.clear();
+    m_head.resize(0);
+    m_fields.resize(0);
+
     m_datetime = QDateTime::currentDateTime();
     m_status = StatusWaitForRequest;
     m_currentSize = 0;
     m_expectedBodySize = 0;
+    m_scanned = 0;
+    m_multiPartSize = 0;
+    m_admitted = false;
+    m_bodyStreamed = false;
+    m_streamedSize = 0;
+    m_parametersDecoded = false;
+    m_cookiesExtracted = false;
+    m_pathDecoded = false;
     m_connection = parent;
+    for (int i=0; i<HeaderUnknown; i++) {
+        m_known[i] = -1;
+        }
 }
 
 
-void HttpRequest::readFromSocket(QTcpSocket *socket) {
+int HttpRequest::readFromBuffer(const QByteArray& buffer, int pos) {
     switch(m_status) {
         case StatusComplete:
-            return;
+            return pos;
             break;
         case StatusAbort:
-            return;
+            return pos;
             break;
         case StatusWaitForRequest:
-            readRequest(socket);
-            break;
         case StatusWaitForHeader:
-            readHeader(socket);
+            pos = readHead(buffer, pos);
             break;
         case StatusWaitForBody:
-            readBody(socket);
             break;
         };
+    // Body is read after the connection admits the request
+    if (m_status == StatusWaitForBody && m_admitted) {
+        pos = readBody(buffer, pos);
+        }
     if (m_currentSize > m_connection->settings()->maxRequestSize()) {
         m_status = StatusAbort;
         }
-    if (m_status == StatusComplete) {
-        decodeRequestParams();
-        extractCookies();
-        }
+    return pos;
 }
 
 
 /**
- * @brief Reads request from socket
+ * @brief Looks for the end of request head (empty line) in the buffer
  *
- * Parses first line of the request and stores the method (GET, PUT, POST...)
- * the path (/path-to-request), version (HTTP/1.1) to class instance.
+ * Lines are searched with memchr(), the search continues from the last incomplete line
+ * when more data arrive. The head is parsed when it is complete.
  */
-void HttpRequest::readRequest(QTcpSocket *socket) {
-    int toRead = m_connection->settings()->maxRequestSize() - m_currentSize + 1;
-    QByteArray newdata = socket->readLine(toRead).trimmed();
-    m_currentSize += newdata.size();
+int HttpRequest::readHead(const QByteArray& buffer, int pos) {
+    const char *data = buffer.constData();
+    int size = buffer.size();
+
+    // Empty lines before the request line are ignored
+    if (m_status == StatusWaitForRequest) {
+        while (pos < size && (data[pos] == '\r' || data[pos] == '\n')) {
+            pos++;
+            }
+        if (pos >= size) {
+            return pos;
+            }
+        m_status = StatusWaitForHeader;
+        m_scanned = 0;
+        }
 
-    if (newdata.isEmpty()) {
-        return;
+    int scan = pos + m_scanned;
+    while (scan < size) {
+        const char *newline = static_cast<const char *>(memchr(data + scan, '\n', size - scan));
+        if (newline == NULL) {
+            break;
+            }
+        int end = newline - data;
+        int length = end - scan;
+        if (length > 0 && data[end-1] == '\r') {
+            length--;
+            }
+        scan = end + 1;
+        if (length == 0) {
+            // Empty line, end of headers
+            m_currentSize += scan - pos;
+            parseHead(data + pos, scan - pos);
+            m_scanned = 0;
+            return scan;
+            }
         }
 
-    QStringList list = QString::fromUtf8(newdata).split(' ');
-    if (list.size() != 3 || !list[2].contains("HTTP")) {
-        qWarning("HttpRequest: received broken HTTP request, invalid first line");
+    m_scanned = scan - pos;
+    if (m_currentSize + size - pos > m_connection->settings()->maxRequestSize()) {
+        qWarning("HttpRequest: request head is too large");
         m_status = StatusAbort;
-        return;
         }
-
-    m_method  = list[0];
-    m_path    = list[1];
-    m_version = list[2];
-    m_status  = StatusWaitForHeader;
-    m_fullpath = m_path;
-    m_connection->setObjectName(m_path);
+    return pos;
 }
 
 
 /**
- * @brief Reads HTTP headers of the request
+ * @brief Parses complete head of the request
+ *
+ * The head is copied once, headers are stored as offsets to the copy
+ * and converted to QString when they are asked for.
  */
-void HttpRequest::readHeader(QTcpSocket *socket) {
-    int toRead = m_connection->settings()->maxRequestSize() - m_currentSize + 1;
-    QByteArray newdata = socket->readLine(toRead).trimmed();
-    m_currentSize += newdata.size();
-
-    int colonpos = newdata.indexOf(':');
-    if (colonpos > 0) { // new header
-        m_currentHeader = QString::fromUtf8(newdata.left(colonpos));
-        QString value   = QString::fromUtf8(newdata.mid(colonpos+1).trimmed());
-        m_headers.insert(m_currentHeader,value);
+void HttpRequest::parseHead(const char *data, int size) {
+    // Buffer reserved by the previous request on the connection is reused
+    if (m_head.capacity() < size) {
+        m_head.reserve(size);
+        }
+    m_head.resize(size);
+    memcpy(m_head.data(), data, size);
+    char *head = m_head.data();
+    int pos = 0;
+    bool first = true;
+    while (pos < size) {
+        const char *newline = static_cast<const char *>(memchr(head + pos, '\n', size - pos));
+        int end = (newline != NULL) ? newline - head : size;
+        int next = end + 1;
+        if (end > pos && head[end-1] == '\r') {
+            end--;
+            }
+        if (end <= pos) {
+            break;
+            }
+
+        if (first) {
+            first = false;
+            if (!parseRequestLine(head + pos, end - pos)) {
+                qWarning("HttpRequest: received broken HTTP request, invalid first line");
+                m_status = StatusAbort;
+                return;
+                }
+            pos = next;
+            continue;
+            }
+
+        const char *colon = static_cast<const char *>(memchr(head + pos, ':', end - pos));
+        if (colon != NULL && colon > head + pos) { // new header
+            HeaderField field;
+            field.name = pos;
+            field.nameLength = colon - head - pos;
+            field.value = colon - head + 1;
+            field.valueLength = end - field.value;
+            trim(head, &field.value, &field.valueLength);
+            field.hash  = nameHash(head + field.name, field.nameLength);
+            field.known = knownHeader(head + field.name, field.nameLength);
+            if (field.known != HeaderUnknown && m_known[field.known] < 0) {
+                m_known[field.known] = m_fields.size();
+                }
+            m_fields << field;
+          } else if (!m_fields.isEmpty()) { // header continues, line breaks are replaced by spaces
+            HeaderField& field = m_fields.last();
+            for (int i = field.value + field.valueLength; i<pos; i++) {
+                head[i] = ' ';
+                }
+            field.valueLength = end - field.value;
+            trim(head, &field.value, &field.valueLength);
+            }
+        pos = next;
+        }
+
+    QString contentType = header(HeaderContentType);
+
+    if (contentType.startsWith("multipart/form-data", Qt::CaseInsensitive)) {
+        int pos  = contentType.indexOf("boundary=", 0, Qt::CaseInsensitive);
+        if (pos >= 0) {
+            m_boundary = contentType.mid(pos+9).toUtf8();
+            }
+        }
+
+    m_expectedBodySize = header(HeaderContentLength).toInt();
+    if (m_expectedBodySize <= 0) {
+        m_status = StatusComplete;
         return;
         }
 
-    if (colonpos <= 0 && !newdata.isEmpty()) { // header continues
-        m_headers.insert(
-                m_currentHeader, 
-                m_headers.value(m_currentHeader) + QString(" ") + QString::fromUtf8(newdata)
-                );
+    m_status = StatusWaitForBody;
+}
+
+
+void HttpRequest::admit(bool streamed) {
+    m_admitted = true;
+    m_bodyStreamed = streamed;
+    if (m_status != StatusWaitForBody || streamed) {
         return;
         }
 
-    if (newdata.isEmpty()) { // Empty line, end of headers
-        QString contentType = header("Content-Type");
+    if (m_boundary.isEmpty() && m_expectedBodySize + m_currentSize > m_connection->settings()->maxRequestSize()) {
+        qWarning("HttpRequest: expected body is too large");
+        m_status = StatusAbort;
+        return;
+        }
 
-        if (contentType.startsWith("multipart/form-data", Qt::CaseInsensitive)) {
-            int pos  = contentType.indexOf("boundary=", 0, Qt::CaseInsensitive);
-            if (pos >= 0) {
-                m_boundary = contentType.mid(pos+9).toUtf8();
-                }
-            }
+    if (!m_boundary.isEmpty() && m_expectedBodySize > m_connection->settings()->maxMultiPartSize()) {
+        qWarning("HttpRequest: expected multipart body is too large");
+        m_status = StatusAbort;
+        return;
+        }
+}
 
-        m_expectedBodySize = header("Content-Length").toInt();
-        if (m_expectedBodySize <= 0) {
-            m_status = StatusComplete;
-            return;
-            }
 
-        if (m_boundary.isEmpty() && m_expectedBodySize + m_currentSize > m_connection->settings()->maxRequestSize()) {
-            qWarning("HttpRequest: expected body is too large");
-            m_status = StatusAbort;
-            return;
-            }
+QByteArray HttpRequest::takeBodyData() {
+    QByteArray data = m_bodyData;
+    m_bodyData.clear();
+    return data;
+}
 
-        if (!m_boundary.isEmpty() && m_expectedBodySize > m_connection->settings()->maxMultiPartSize()) {
-            qWarning("HttpRequest: expected multipart body is too large");
-            m_status = StatusAbort;
-            return;
-            }
 
-        m_status = StatusWaitForBody;
-        
+/**
+ * @brief Parses first line of the request
+ *
+ * Stores the method (GET, PUT, POST...), the path (/path-to-request)
+ * and version (HTTP/1.1) to class instance.
+ */
+bool HttpRequest::parseRequestLine(const char *data, int size) {
+    const char *space1 = static_cast<const char *>(memchr(data, ' ', size));
+    if (space1 == NULL) {
+        return false;
+        }
+    const char *space2 = static_cast<const char *>(memchr(space1 + 1, ' ', data + size - space1 - 1));
+    if (space2 == NULL || memchr(space2 + 1, ' ', data + size - space2 - 1) != NULL) {
+        return false;
+        }
+
+    QByteArray version(space2 + 1, data + size - space2 - 1);
+    if (!version.contains("HTTP")) {
+        return false;
+        }
+
+    m_method  = QString::fromLatin1(data, space1 - data);
+    m_path    = QString::fromUtf8(space1 + 1, space2 - space1 - 1);
+    m_version = QString::fromLatin1(version);
+    m_fullpath = m_path;
+
+    // Query is decoded later when parameters are needed
+    int questionmarkpos = m_path.indexOf('?');
+    if (questionmarkpos >= 0) {
+        m_query = m_path.mid(questionmarkpos+1);
+        m_path  = m_path.left(questionmarkpos);
         }
+    m_connection->setObjectName(m_path);
+    return true;
+}
 
+
+/**
+ * @brief Removes spaces and tabs around the part of the head
+ */
+void HttpRequest::trim(const char *head, int *start, int *length) {
+    while (*length > 0 && (head[*start] == ' ' || head[*start] == '\t')) {
+        (*start)++;
+        (*length)--;
+        }
+    while (*length > 0 && (head[*start + *length - 1] == ' ' || head[*start + *length - 1] == '\t')) {
+        (*length)--;
+        }
 }
 
 
 /**
- * @brief Reads body of the request
+ * @brief Reads body of the request from the buffer
  */
-void HttpRequest::readBody(QTcpSocket *socket) {
+int HttpRequest::readBody(const QByteArray& buffer, int pos) {
+    int available = buffer.size() - pos;
+
+    // Streamed body is not collected, HttpConnection passes every part to the handler
+    if (m_bodyStreamed) {
+        int toRead = qMin(m_expectedBodySize - m_streamedSize, available);
+        m_bodyData.append(buffer.constData() + pos, toRead);
+        m_streamedSize += toRead;
+        if (m_streamedSize >= m_expectedBodySize) {
+            m_status = StatusComplete;
+            }
+        return pos + toRead;
+        }
+
     // normal body, no multipart
     if (m_boundary.isEmpty()) {
-        int toRead = m_expectedBodySize - m_bodyData.size();
-        QByteArray newdata = socket->read(toRead);
-        m_currentSize += newdata.size();
-
-        m_bodyData.append(newdata);
+        int toRead = qMin(m_expectedBodySize - m_bodyData.size(), available);
+        m_bodyData.append(buffer.constData() + pos, toRead);
+        m_currentSize += toRead;
         if (m_bodyData.size() >= m_expectedBodySize) {
             m_status = StatusComplete;
             }
-        return;
+        return pos + toRead;
         }
 
-    // Multipart body
-    if (!m_boundary.isEmpty()) {
-        if (!m_tempFile.isOpen()) {
-            m_tempFile.open();
-            }
-        int filesize = m_tempFile.size();
-        int toRead = m_expectedBodySize - filesize;
-        if (toRead > 65536) {
-            toRead = 65536;
-            }
+    // Multipart body is parsed as it arrives, uploaded files are written directly to their files
+    if (m_multiPart == NULL) {
+        m_multiPart = new HttpMultiPartParser(m_boundary);
+        }
+    int toRead = qMin(m_expectedBodySize - m_multiPartSize, available);
 
-        filesize += m_tempFile.write(socket->read(toRead));
-        if (filesize >= m_connection->settings()->maxMultiPartSize()) {
-            qWarning("HttpRequest: received too many multipart bytes");
-            m_status = StatusAbort;
-            return;
-            }
+    m_multiPart->write(buffer.constData() + pos, toRead);
+    m_multiPartSize += toRead;
+    if (m_multiPartSize >= m_connection->settings()->maxMultiPartSize()) {
+        qWarning("HttpRequest: received too many multipart bytes");
+        m_status = StatusAbort;
+        return pos + toRead;
+        }
 
-        if (filesize >= m_expectedBodySize) {
-            m_tempFile.flush();
-            parseMultiPartFile();
-            m_tempFile.close();
-            m_status = StatusComplete;
-            }
+    if (m_multiPartSize >= m_expectedBodySize) {
+        m_parameters.unite(m_multiPart->parameters());
+        m_uploadedFiles = m_multiPart->takeUploadedFiles();
+        m_contentTypes  = m_multiPart->contentTypes();
+        delete m_multiPart;
+        m_multiPart = NULL;
+        m_status = StatusComplete;
         }
 
+    return pos + toRead;
+}
+
+
+QString HttpRequest::path() const {
+    if (!m_pathDecoded) {
+        m_decodedPath = urlDecode(m_path);
+        m_pathDecoded = true;
+        }
+    return m_decodedPath;
 }
 
 
 /**
- * @brief Parses parameters of the URL
+ * @brief Parses parameters of the URL or of the form, called on first access to parameters
  */
-void HttpRequest::decodeRequestParams() {
+void HttpRequest::decodeRequestParams() const {
+    if (m_parametersDecoded || m_status != StatusComplete) { return; }
+    m_parametersDecoded = true;
+
     QString rawParameters;
-    if (header("Content-Type").toLower() == "application/x-www-form-urlencoded") {
+    if (header(HeaderContentType).toLower() == "application/x-www-form-urlencoded") {
         rawParameters = m_bodyData;
       } else {
-        int questionmarkpos = m_path.indexOf('?');
-        if (questionmarkpos >= 0) {
-            rawParameters = m_path.mid(questionmarkpos+1);
-            m_path = m_path.left(questionmarkpos);
-            }
+        rawParameters = m_query;
         }
 
     QStringList list = rawParameters.split('&');
@@ -224,10 +517,13 @@ void HttpRequest::decodeRequestParams() {
 
 
 /**
- * @brief Parses cookies 
+ * @brief Parses cookies, called on first access to cookies
  */
-void HttpRequest::extractCookies() {
-    QStringList cookies = headers("Cookie");
+void HttpRequest::extractCookies() const {
+    if (m_cookiesExtracted || m_status != StatusComplete) { return; }
+    m_cookiesExtracted = true;
+
+    QStringList cookies = headers(HeaderCookie);
     for (int i=0; i<cookies.size(); i++) {
         // rozdělit řádek podle středníků
         QStringList parts = cookies[i].split(";");
@@ -249,126 +545,91 @@ void HttpRequest::extractCookies() {
                 }
             }
         }
-    header("Cookie");
 }
 
 
 /**
- * @brief Dedodes % encoding used in URL
+ * @brief Decodes % encoding used in URL
+ *
+ * Decoded bytes are written in one pass to the output buffer.
+ * Strings without % and + are returned unchanged.
  */
 QString HttpRequest::urlDecode(const QString& text) {
-    QByteArray buffer(text.toUtf8());
-    buffer.replace('+',' ');
-    int percentpos = buffer.indexOf('%');
-    while (percentpos >= 0) {
-        bool ok;
-        // QChar byte = QChar((int)buffer.mid(percentpos+1, 2).toInt(&ok, 16));
-        int byte = buffer.mid(percentpos+1, 2).toInt(&ok, 16);
-        if (ok) {
-            buffer.remove(percentpos,3);
-            buffer.insert(percentpos, byte);
+    if (!text.contains('%') && !text.contains('+')) {
+        return text;
+        }
+
+    QByteArray source(text.toUtf8());
+    QByteArray buffer(source.size(), Qt::Uninitialized);
+    const char *in  = source.constData();
+    const char *end = in + source.size();
+    char *out = buffer.data();
+    while (in < end) {
+        char c = *in++;
+        if (c == '+') {
+            *out++ = ' ';
+            continue;
             }
-        percentpos = buffer.indexOf('%', percentpos+1);
+        if (c == '%' && end - in >= 2) {
+            int high = hexValue(in[0]);
+            int low  = hexValue(in[1]);
+            if (high >= 0 && low >= 0) {
+                *out++ = (char)(high * 16 + low);
+                in += 2;
+                continue;
+                }
+            }
+        *out++ = c;
         }
+    buffer.resize(out - buffer.data());
     return QString::fromUtf8(buffer);
 }
 
 
 /**
- * @brief Parses the mime multipart request
+ * @brief Returns the id of well-known header or HeaderUnknown
  */
-void HttpRequest::parseMultiPartFile() {
-    m_tempFile.seek(0);
-    bool finished=false;
-    while (!m_tempFile.atEnd() && !finished && !m_tempFile.error()) {
-
-        QString fieldName;
-        QString fileName;
-        QString contentType;
-        while (!m_tempFile.atEnd() && !finished && !m_tempFile.error()) {
-            QString line = QString::fromUtf8(m_tempFile.readLine(65536).trimmed());
-            if (line.startsWith("--"+m_boundary)) { continue; }
-            if (line.isEmpty()) { break; }
-            if (line.startsWith("Content-Disposition:", Qt::CaseInsensitive)) { 
-                if (line.contains("form-data", Qt::CaseInsensitive)) {
-                    int start=line.indexOf(" name=\"", 0, Qt::CaseInsensitive);
-                    int end=line.indexOf("\"",start+7);
-                    if (start>=0 && end>=start) {
-                        fieldName=line.mid(start+7,end-start-7);
-                        }
-                    start=line.indexOf(" filename=\"", 0, Qt::CaseInsensitive);
-                    end=line.indexOf("\"",start+11);
-                    if (start>=0 && end>=start) {
-                        fileName=line.mid(start+11,end-start-11);
-                        }
-                    continue;
-                    }
-                }
-            if (line.startsWith("Content-Type:", Qt::CaseInsensitive)) { 
-                contentType = line.remove(QRegExp("^Content-Type:\\s*", Qt::CaseInsensitive));
-                continue;
-                }
-
-            qDebug() << "HttpRequest: ignoring unsupported content part" << line;
+HttpRequest::KnownHeader HttpRequest::knownHeader(const char *name, int length) {
+    for (uint i=0; i<sizeof(knownHeaderNames)/sizeof(knownHeaderNames[0]); i++) {
+        if (knownHeaderNames[i].length == length && qstrnicmp(knownHeaderNames[i].name, name, length) == 0) {
+            return knownHeaderNames[i].id;
             }
+        }
+    return HeaderUnknown;
+}
 
-        QTemporaryFile* uploadedFile=0;
-        QByteArray fieldValue;
-        while (!m_tempFile.atEnd() && !finished && !m_tempFile.error()) {
-            QByteArray line = m_tempFile.readLine(65536);
-            if (line.startsWith("--"+m_boundary)) {
-                // Boundary found. Until now we have collected 2 bytes too much,
-                // so remove them from the last result
-                if (fileName.isEmpty() && !fieldName.isEmpty()) {
-                    // last field was a form field
-                    fieldValue.remove(fieldValue.size()-2,2);
-                    m_parameters.insert(fieldName,fieldValue);
-                    }
-                else if (!fileName.isEmpty() && !fieldName.isEmpty()) {
-                    // last field was a file
-                    uploadedFile->resize(uploadedFile->size()-2);
-                    uploadedFile->flush();
-                    uploadedFile->seek(0);
-                    m_parameters.insert(fieldName,fileName);
-                    m_uploadedFiles.insert(fieldName,uploadedFile);
-                    m_contentTypes.insert(fieldName,contentType);
-                    }
-                if (line.contains(m_boundary+"--")) {
-                    finished=true;
-                    }
-                break;
-              } else {
-                if (fileName.isEmpty() && !fieldName.isEmpty()) {
-                    // this is a form field.
-                    m_currentSize+=line.size();
-                    fieldValue.append(line);
-                    }
-                else if (!fileName.isEmpty() && !fieldName.isEmpty()) {
-                    // this is a file
-                    if (!uploadedFile) {
-                        uploadedFile=new QTemporaryFile();
-                        uploadedFile->open();
-                        }
-                    uploadedFile->write(line);
-                    if (uploadedFile->error()) {
-                        qCritical("HttpRequest: error writing temp file, %s",qPrintable(uploadedFile->errorString()));
-                        }
-                    }
-                }
-            }
+
+QString HttpRequest::header(KnownHeader id) const {
+    if (id < 0 || id >= HeaderUnknown || m_known[id] < 0) {
+        return QString();
         }
-    if (m_tempFile.error()) {
-        qCritical("HttpRequest: cannot read temp file, %s",qPrintable(m_tempFile.errorString()));
+    const HeaderField& field = m_fields[m_known[id]];
+    return QString::fromUtf8(m_head.constData() + field.value, field.valueLength);
+}
+
+
+QList<QString>  HttpRequest::headers(KnownHeader id) const {
+    QList<QString> list;
+    if (id < 0 || id >= HeaderUnknown || m_known[id] < 0) {
+        return list;
         }
+    for (int i=m_known[id]; i<m_fields.size(); i++) {
+        const HeaderField& field = m_fields[i];
+        if (field.known == id) {
+            list << QString::fromUtf8(m_head.constData() + field.value, field.valueLength);
+            }
+        }
+    return list;
 }
 
 
 QString HttpRequest::header(const QString& name) const { 
-    QMapIterator<QString, QString>  iterator(m_headers);
-    while (iterator.hasNext()) {
-        iterator.next();
-        if (iterator.key().toLower() == name.toLower()) {
-            return iterator.value();
+    uint hash = nameHash(name);
+    for (int i=0; i<m_fields.size(); i++) {
+        const HeaderField& field = m_fields[i];
+        if (field.hash == hash && field.nameLength == name.size() &&
+                name.compare(QLatin1String(m_head.constData() + field.name, field.nameLength), Qt::CaseInsensitive) == 0) {
+            return QString::fromUtf8(m_head.constData() + field.value, field.valueLength);
             }
         }
     return QString();
@@ -376,16 +637,38 @@ QString HttpRequest::header(const QString& name) const {
 
 
 QList<QString>  HttpRequest::headers(const QString& name) const {
-    QMapIterator<QString, QString>  iterator(m_headers);
-    while (iterator.hasNext()) {
-        iterator.next();
-        if (iterator.key().toLower() == name.toLower()) {
-            return m_headers.values(iterator.key());
+    uint hash = nameHash(name);
+    QList<QString> list;
+    for (int i=0; i<m_fields.size(); i++) {
+        const HeaderField& field = m_fields[i];
+        if (field.hash == hash && field.nameLength == name.size() &&
+                name.compare(QLatin1String(m_head.constData() + field.name, field.nameLength), Qt::CaseInsensitive) == 0) {
+            list << QString::fromUtf8(m_head.constData() + field.value, field.valueLength);
             }
         }
-    return QList<QString>();
+    return list;
+}
+
+
+bool HttpRequest::keepAlive() const {
+    if (m_version != "HTTP/1.1") {
+        return false;
+        }
+    return header(HeaderConnection).toLower() != "close";
 }
 
+
+QMultiMap<QString, QString> HttpRequest::headerMap() const {
+    QMultiMap<QString, QString> map;
+    for (int i=0; i<m_fields.size(); i++) {
+        const HeaderField& field = m_fields[i];
+        map.insert(QString::fromUtf8(m_head.constData() + field.name,  field.nameLength),
+                   QString::fromUtf8(m_head.constData() + field.value, field.valueLength));
+        }
+    return map;
+}
+
+
 QString HttpRequest::statusString() const {
     QString text;
     switch (m_status) {
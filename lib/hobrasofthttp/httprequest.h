@@ -12,10 +12,13 @@
 #include <QDateTime>
 #include <QTcpSocket>
 #include <QString>
+#include <QVector>
+#include <QMultiMap>
 #include "httpconnection.h"
 
 namespace HobrasoftHttpd {
 
+class HttpMultiPartParser;
 
 /**
  * @brief Processes HTTP request, parses headers, body and files sent by HTTP protocol
@@ -33,11 +36,52 @@ class HttpRequest {
         StatusAbort                 ///< Request is canceled
         };
 
+    /**
+     * @brief Well-known headers, they are found without comparing names
+     */
+    enum KnownHeader {
+        HeaderHost,                 ///< Host
+        HeaderConnection,           ///< Connection
+        HeaderContentType,          ///< Content-Type
+        HeaderContentLength,        ///< Content-Length
+        HeaderAcceptEncoding,       ///< Accept-Encoding
+        HeaderCookie,               ///< Cookie
+        HeaderExpect,               ///< Expect
+        HeaderRange,                ///< Range
+        HeaderIfRange,              ///< If-Range
+        HeaderIfNoneMatch,          ///< If-None-Match
+        HeaderIfModifiedSince,      ///< If-Modified-Since
+        HeaderUnknown               ///< Other header, also the number of well-known headers
+        };
+
     /**
      * @brief Constructor sets default falues from configuration
      */
     HttpRequest(HttpConnection *connection);
 
+    /**
+     * @brief Returns request from the pool of the current thread or new request
+     *
+     * Released requests keep the capacity of their buffers, parsing of next request
+     * on a keep-alive connection does not allocate memory for the head and headers.
+     */
+    static HttpRequest *create(HttpConnection *connection);
+
+    /**
+     * @brief Returns the request to the pool of the current thread or deletes it when the pool is full
+     *
+     * Must be called in the thread where the request was created.
+     * Uploaded files of the request are deleted.
+     */
+    static void release(HttpRequest *request);
+
+    /**
+     * @brief Clears the request to the state of new request, capacity of buffers is kept
+     */
+    void reset(HttpConnection *connection);
+
+   ~HttpRequest();
+
     /**
      * @brief Returns HttpConnection of the request
      */
@@ -51,11 +95,47 @@ class HttpRequest {
 
 
     /**
-     * @brief Reads data from socket.
+     * @brief Reads data from the receive buffer of the connection
+     *
+     * Called from HttpConnection when reading the request. Data of the request
+     * are consumed from the position, the rest of the buffer belongs to next
+     * (pipelined) requests.
+     *
+     * @param buffer - receive buffer of the connection
+     * @param pos - position of the first unread byte in the buffer
+     * @returns position of the first byte not consumed by the request
+     */
+    int readFromBuffer(const QByteArray& buffer, int pos);
+
+    /**
+     * @brief Allows reading of the body, called from HttpConnection when the head is complete
      *
-     * Called from HttpConnection when reading the request
+     * The body is not read until the request is admitted. Size limits of the body
+     * are checked here unless the body is streamed.
+     *
+     * @param streamed - body is passed in parts to HttpRequestHandler::bodyData() instead of being collected
+     */
+    void admit(bool streamed);
+
+    /**
+     * @brief Refuses the request, its body is not read
+     */
+    void reject() { m_status = StatusAbort; }
+
+    /**
+     * @brief Returns true if the request was admitted and the body can be read
+     */
+    bool isAdmitted() const { return m_admitted; }
+
+    /**
+     * @brief Returns true if the body is passed to the handler in parts
+     */
+    bool isBodyStreamed() const { return m_bodyStreamed; }
+
+    /**
+     * @brief Returns the part of streamed body received since the last call
      */
-    void readFromSocket(QTcpSocket *socket);
+    QByteArray takeBodyData();
 
     /**
      * @brief Returns current status of the request
@@ -75,7 +155,7 @@ class HttpRequest {
     /**
      * @brief Returns path of the request (/files/index.html)
      */
-    QString    path() const { return urlDecode(m_path); }
+    QString    path() const;
 
     /**
      * @brief Returns full path of the request (/files/index.html) including parameters
@@ -87,11 +167,24 @@ class HttpRequest {
      */
     QString    version() const { return m_version; }
 
+    /**
+     * @brief Returns true if the connection should stay open after the response
+     *
+     * HTTP/1.1 connections are persistent unless the client sends "Connection: close".
+     * HTTP/1.0 connections are always closed.
+     */
+    bool       keepAlive() const;
+
     /**
      * @brief Returns requested header value, case insensitive
      */
     QString    header(const QString& name) const;
 
+    /**
+     * @brief Returns value of well-known header, the header is found in constant time
+     */
+    QString    header(KnownHeader id) const;
+
     /**
      * @brief Returns all headers of HTTP request in QList, case insensitive
      *
@@ -99,12 +192,17 @@ class HttpRequest {
      */
     QList<QString>  headers(const QString& name) const;
 
+    /**
+     * @brief Returns all values of well-known header in QList
+     */
+    QList<QString>  headers(KnownHeader id) const;
+
     /**
      * @brief Returns all headers of HTTP request in QMap
      *
      * Cookies are not contined in the returnetd values. If you want to read cookies, use cookie() method instead.
      */
-    QMultiMap<QString, QString>     headerMap() const { return m_headers; }
+    QMultiMap<QString, QString>     headerMap() const;
 
     /**
      * @brief Returns parameter of the HTTP request
@@ -112,23 +210,26 @@ class HttpRequest {
      * Parameters are typically used in GET requests:
      *
      * http://my-own-server.com/path?param1=abc&param2=xyz
+     *
+     * Parameters are decoded when they are asked for the first time.
      */
-    QString  parameter(const QString& name) const { return m_parameters.value(name); }
+    QString  parameter(const QString& name) const { decodeRequestParams(); return m_parameters.value(name); }
 
     /**
      * @brief Returns all parameters of the HTTP request in QList
      */
-    QList<QString>  parameters(const QString& name) const {  return m_parameters.values(name); }
+    QList<QString>  parameters(const QString& name) const { decodeRequestParams(); return m_parameters.values(name); }
 
     /**
      * @brief Returns all parameters of the HTTP request in QMap
      */
-    QMultiMap<QString, QString>     parameterMap() const { return m_parameters; }
+    QMultiMap<QString, QString>     parameterMap() const { decodeRequestParams(); return m_parameters; }
 
     /**
      * @brief Returns the body of the request
      *
-     * Use this method when you need to read POST requests
+     * Use this method when you need to read POST requests.
+     * The body is empty when it was streamed to the handler.
      */
     QByteArray  body() const { return m_bodyData; }
 
@@ -139,22 +240,32 @@ class HttpRequest {
 
     /**
      * @brief Returns cookie
+     *
+     * Cookies are parsed when they are asked for the first time.
      */
-    QString cookie(const QString& name) const { return m_cookies.value(name); }
+    QString cookie(const QString& name) const { extractCookies(); return m_cookies.value(name); }
 
     /**
      * @brief Returns all cookies of the request in QMap
      */
-    const QMap<QString, QString>& cookieMap() { return m_cookies; }
+    const QMap<QString, QString>& cookieMap() { extractCookies(); return m_cookies; }
 
     /**
      * @brief Returns temporary file with uploaded file from html form
      *
-     * If the returned file is closed, then the file is deleted.
-     * If you want to reuse the file, do not close it.
+     * The file is owned by the request, it is deleted when the request is released
+     * after its response. Use takeUploadedFile() if you want to keep the file longer.
      */
     QTemporaryFile *uploadedFile(const QString& fieldName) { return m_uploadedFiles.value(fieldName); }
 
+    /**
+     * @brief Returns temporary file with uploaded file and transfers its ownership to the caller
+     *
+     * The caller is responsible for deleting the file, the request forgets it.
+     * If the returned file is closed, then the file is deleted from the disk.
+     */
+    QTemporaryFile *takeUploadedFile(const QString& fieldName) { return m_uploadedFiles.take(fieldName); }
+
     /**
      * @brief Returns list of uploaded files
      *
@@ -162,8 +273,8 @@ class HttpRequest {
      * - Key: name of the field
      * - Value: opened temporary file
      *
-     * If the returned file is closed, then the file is deleted.
-     * If you want to reuse the file, do not close it.
+     * Files are owned by the request and deleted when the request is released,
+     * use takeUploadedFile() to keep a file.
      */
     const QMap<QString, QTemporaryFile *>&  uploadedFiles() const { return m_uploadedFiles; }
 
@@ -192,37 +303,61 @@ class HttpRequest {
 
   private:
     #ifndef DOXYGEN_SHOULD_SKIP_THIS
-    QMultiMap<QString, QString>         m_headers;
-    QMultiMap<QString, QString>         m_parameters;
+    struct HeaderField {
+        int name;
+        int nameLength;
+        int value;
+        int valueLength;
+        uint hash;                      // case insensitive hash of the name
+        KnownHeader known;
+        };
+
+    QByteArray                          m_head;
+    QVector<HeaderField>                m_fields;
+    int                                 m_known[HeaderUnknown];
+    mutable QMultiMap<QString, QString> m_parameters;
+    mutable bool                        m_parametersDecoded;
     QMap<QString, QTemporaryFile *>     m_uploadedFiles;
     QMap<QString, QString>              m_contentTypes;
-    QMap<QString, QString>              m_cookies;
+    mutable QMap<QString, QString>      m_cookies;
+    mutable bool                        m_cookiesExtracted;
+    mutable QString                     m_decodedPath;
+    mutable bool                        m_pathDecoded;
     QByteArray                          m_bodyData;
     QString                             m_method;
     QString                             m_path;
+    QString                             m_query;
     QString                             m_fullpath;
     QString                             m_version;
     Status                              m_status;
     QByteArray                          m_boundary;
     int                                 m_currentSize;
     int                                 m_expectedBodySize;
-    QString                             m_currentHeader;
-    QTemporaryFile                      m_tempFile;
+    int                                 m_scanned;
+    HttpMultiPartParser                *m_multiPart;
+    int                                 m_multiPartSize;
+    int                                 m_streamedSize;
+    bool                                m_admitted;
+    bool                                m_bodyStreamed;
     HttpConnection                     *m_connection;
     QDateTime                           m_datetime;
     #endif
 
-    void    parseMultiPartFile();
+    int     readHead(const QByteArray& buffer, int pos);
+
+    int     readBody(const QByteArray& buffer, int pos);
+
+    void    parseHead(const char *data, int size);
 
-    void    readRequest(QTcpSocket* socket);
+    bool    parseRequestLine(const char *data, int size);
 
-    void    readHeader (QTcpSocket* socket);
+    static void trim(const char *head, int *start, int *length);
 
-    void    readBody   (QTcpSocket* socket);
+    static KnownHeader knownHeader(const char *name, int length);
 
-    void    decodeRequestParams();
+    void    decodeRequestParams() const;
 
-    void    extractCookies();
+    void    extractCookies() const;
 
 };
 
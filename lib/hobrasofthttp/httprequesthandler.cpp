@@ -33,6 +33,25 @@ void HttpRequestHandler::service(HttpRequest *request, HttpResponse *response) {
 }
 
 
+bool HttpRequestHandler::admitRequest(HttpRequest *request, HttpResponse *response) {
+    Q_UNUSED(request);
+    Q_UNUSED(response);
+    return true;
+}
+
+
+bool HttpRequestHandler::streamBody(HttpRequest *request) {
+    Q_UNUSED(request);
+    return false;
+}
+
+
+void HttpRequestHandler::bodyData(HttpRequest *request, const QByteArray& data) {
+    Q_UNUSED(request);
+    Q_UNUSED(data);
+}
+
+
 HttpResponse *HttpRequestHandler::response() {
     return m_connection->response();
 }
@@ -96,6 +96,46 @@ class HttpRequestHandler : public QObject {
      */
     virtual void service(HttpRequest *request, HttpResponse *response);
 
+    /**
+     * @brief Admission of the request with body, called when its headers are complete
+     *
+     * The method is called before any byte of the body is read. When the request is refused,
+     * the handler sets the status (403 is used when no error status is set) and it can
+     * write the body of the response. The response is sent, the body of the request is
+     * not read and the connection is closed. Clients sending "Expect: 100-continue"
+     * do not send the body at all.
+     *
+     * The response must not be used when the request is admitted.
+     *
+     * Default implementation admits every request.
+     *
+     * @returns true if the request is admitted
+     */
+    virtual bool admitRequest(HttpRequest *request, HttpResponse *response);
+
+    /**
+     * @brief Decides whether the body of the request is passed to the handler in parts
+     *
+     * Called when the headers of a request with body are complete. When the method
+     * returns true, the body is not collected in memory and it is not limited
+     * by HttpSettings::maxRequestSize(). Every part of the body received from network
+     * is passed to bodyData(), service() is called when the whole body is received.
+     *
+     * The handler can stop reading the socket with HttpConnection::pauseReading()
+     * while it processes the data and continue with HttpConnection::resumeReading().
+     *
+     * Default implementation returns false, the body is collected and available
+     * in HttpRequest::body().
+     */
+    virtual bool streamBody(HttpRequest *request);
+
+    /**
+     * @brief Receives next part of the streamed body
+     *
+     * @see streamBody()
+     */
+    virtual void bodyData(HttpRequest *request, const QByteArray& data);
+
     /**
      * @brief Returns new instance of HttpResponse class
      *
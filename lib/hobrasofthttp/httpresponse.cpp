@@ -8,20 +8,28 @@
 #include "httpresponse.h"
 #include "httprequest.h"
 #include "httpconnection.h"
+#include "httpcontentencoding.h"
 #include "httpgzipcompression.h"
+#include "httpcontentcache.h"
 #include <QStringList>
 
 #include <QDebug>
 
 using namespace HobrasoftHttpd;
 
+/**
+ * @brief Size of blocks in which parts of files are read and written to the socket
+ */
+#define FILE_BLOCK_SIZE 65536
+
 
 HttpResponse::~HttpResponse() {
 }
 
 
-HttpResponse::HttpResponse(HttpConnection *connection) : QObject(connection) {
+HttpResponse::HttpResponse(HttpConnection *connection, HttpRequest *request) : QObject(connection) {
     m_connection = connection;
+    m_request = request;
     m_socket = m_connection->socket();
     m_flushed = false;
     m_statusCode = 200;
@@ -32,11 +40,12 @@ HttpResponse::HttpResponse(HttpConnection *connection) : QObject(connection) {
     m_canWriteToSocket = false;
     m_closeAfterFlush = false;
     m_deleteAfterFlush = false;
-    m_writerTimer = new QTimer(this);
-    m_writerTimer->setInterval(1000);
-    m_writerTimer->setSingleShot(true);
-    connect (m_writerTimer, SIGNAL(timeout()),
-             this,            SLOT(slotWrite()));
+    m_writeScheduled = false;
+    m_chunked = false;
+    m_chunkedValid = true;
+    m_bodyPartsSize = 0;
+    m_keepAlive = (m_request != NULL) ? m_request->keepAlive() : true;
+    m_connection->addResponse(this);
     connect (m_socket, SIGNAL(bytesWritten(qint64)),
              this,            SLOT(slotWrite()));
 }
@@ -50,22 +59,53 @@ bool HttpResponse::isConnected() const {
 void HttpResponse::setHeader(const QString& name, const QString& value) {
     if (m_sentHeaders) { return; }
     m_headers[name] = value;
+    if (name.compare(QLatin1String("Transfer-Encoding"), Qt::CaseInsensitive) == 0) {
+        m_chunkedValid = false;
+        }
 }
 
 
 void HttpResponse::setHeader(const QString& name, int value) {
-    if (m_sentHeaders) { return; }
-    m_headers[name] = QString("%1").arg(value);
+    setHeader(name, QString::number(value));
 }
 
 
 QMap<QString, QString>& HttpResponse::headers() {
+    // Headers can be changed through the reference
+    m_chunkedValid = false;
     return m_headers;
 }
 
 
 void HttpResponse::clearHeaders() {
     m_headers.clear();
+    m_chunkedValid = false;
+}
+
+
+/**
+ * @brief Returns true if the response uses chunked transfer encoding
+ *
+ * The value is cached, it is checked on every write to the socket.
+ */
+bool HttpResponse::isChunked() {
+    if (!m_chunkedValid) {
+        m_chunked = m_headers.value("Transfer-Encoding").compare(QLatin1String("chunked"), Qt::CaseInsensitive) == 0;
+        m_chunkedValid = true;
+        }
+    return m_chunked;
+}
+
+
+bool HttpResponse::yieldsTo(HttpResponse *next) {
+    bool pending = m_dataHeaders.size() > m_dataHeadersPointer || m_dataBody.size() > m_dataBodyPointer || !m_bodyParts.isEmpty();
+    if (pending) {
+        return false;
+        }
+    if (isChunked() && m_sentHeaders) {
+        return true;
+        }
+    return !m_sentHeaders && !m_flushed && m_request == next->request() && next->isChunked();
 }
 
 
@@ -86,29 +126,70 @@ void HttpResponse::writeHeaders() {
         contentType.startsWith("application/javascript")
         );
 
-    bool requestGzip = (
-        m_connection->request() != NULL &&
-        m_connection->request()->header("Accept-Encoding").contains("gzip")
-        );
+    QString acceptEncoding = (m_request != NULL)
+                           ? m_request->header(HttpRequest::HeaderAcceptEncoding)
+                           : QString();
 
-    bool chunked = m_headers.value("Transfer-Encoding").toLower() == "chunked" ;
+    bool chunked = isChunked();
+
+    // Chunked response is ended by closing the connection
+    if (chunked) {
+        m_connection->setChunked(true);
+        }
+
+    // Interim response (100 Continue) has no body and does not end the connection
+    bool interim = (m_statusCode < 200);
+
+    if ((!m_keepAlive || m_closeAfterFlush) && !interim && !m_headers.contains("Connection")) {
+        setHeader("Connection", "close");
+        }
 
     bool c200 = (m_statusCode == 200);
 
-    if (cancompress && requestGzip && !chunked && c200) {
+    // Body with Content-Encoding set by the handler is already encoded (precompressed files)
+    bool encoded = m_headers.contains("Content-Encoding");
+
+    if (cancompress && !encoded) {
+        setHeader("Vary", "Accept-Encoding");
+        }
+
+    // Chunked responses are compressed incrementally in write(), only gzip can be streamed
+    if (cancompress && chunked && c200 && !encoded &&
+            HttpContentEncoding::negotiate(acceptEncoding, QList<QByteArray>() << "gzip") == "gzip") {
         setHeader("Content-Encoding", "gzip");
+        setEncodedEntityTag("gzip");
+        m_connection->setGZipStream(new HttpGZipStream());
         }
 
-    // int dbs = m_dataBody.size();
-    if (m_headers.value("Content-Encoding").toLower() == "gzip" ) {
-        m_dataBody = HttpGZipCompression::compressData(m_dataBody);
+    QByteArray encoding;
+    if (cancompress && !chunked && c200 && !encoded && m_bodyParts.isEmpty()) {
+        encoding = HttpContentEncoding::negotiate(acceptEncoding);
+        }
+
+    const HttpContentEncoder *encoder = HttpContentEncoding::encoder(encoding);
+    if (encoder != NULL) {
+        QByteArray compressed;
+        if (m_contentDigest.isEmpty() || !HttpContentCache::encoded(m_contentDigest, encoding, &compressed)) {
+            compressed = encoder->encode(m_dataBody);
+            if (!m_contentDigest.isEmpty() && !compressed.isEmpty()) {
+                HttpContentCache::insertEncoded(m_contentDigest, encoding, compressed);
+                }
+            }
+        if (!compressed.isEmpty()) {
+            setHeader("Content-Encoding", QString::fromLatin1(encoding));
+            setEncodedEntityTag(encoding);
+            m_dataBody = compressed;
+            }
         }
 
-    m_headers["Content-Length"] = QString("%1").arg(m_dataBody.size());
+    // 304 and 204 responses have no body
+    if (!chunked && !interim && m_statusCode != 304 && m_statusCode != 204) {
+        m_headers["Content-Length"] = QString("%1").arg(m_dataBody.size() + m_bodyPartsSize);
+        }
     /*
-    qDebug() << "gzip" << cancompress << requestGzip << !chunked << m_headers.value("Content-Type") << dbs << m_dataBody.size()
-            << ( (m_connection->request() != NULL) ? m_connection->request()->path() : "") 
-            << ( (m_connection->request() != NULL) ? m_connection->request()->header("Accept-Encoding") : "") 
+    qDebug() << "encoding" << cancompress << encoding << !chunked << m_headers.value("Content-Type") << dbs << m_dataBody.size()
+            << ( (m_request != NULL) ? m_request->path() : "") 
+            << ( (m_request != NULL) ? m_request->header(HttpRequest::HeaderAcceptEncoding) : "") 
             << contentType
             ;
     */
@@ -140,6 +221,15 @@ void HttpResponse::writeHeaders() {
 }
 
 
+/**
+ * @brief Changes the entity tag set by handler to the tag of encoded representation
+ */
+void HttpResponse::setEncodedEntityTag(const QByteArray& encoding) {
+    if (!m_headers.contains("ETag")) { return; }
+    m_headers["ETag"] = QString::fromLatin1(HttpContentEncoding::entityTag(m_headers.value("ETag").toLatin1(), encoding));
+}
+
+
 void HttpResponse::setCookie(const HttpCookie& cookie) {
     if (cookie.name().isEmpty()) return;
     m_cookies[cookie.name()] = cookie;
@@ -156,29 +246,35 @@ void HttpResponse::flushSocket() {
 
 void HttpResponse::close() {
     if (!isConnected()) { return; }
-    bool chunked = m_headers.value("Transfer-Encoding").toLower() == "chunked" ;
+    bool chunked = isChunked();
     if (chunked) {
-        m_socket->write("0\r\n\r\n");
+        HttpGZipStream *stream = m_connection->gzipStream();
+        if (stream != NULL) {
+            appendChunk(stream->finish());
+            m_connection->setGZipStream(NULL);
+            }
+        m_dataBody += "0\r\n\r\n";
         }
+
+    // Data not written yet must precede the last chunk
+    writeBuffer(m_dataHeaders, m_dataHeadersPointer);
+    writeBuffer(m_dataBody, m_dataBodyPointer);
+    // The socket writes pending data before it is closed, no need to block the thread here
     m_socket->flush();
-    m_socket->waitForBytesWritten(10000);
     m_socket->disconnectFromHost();
 }
 
 
 void HttpResponse::write(const QByteArray& data) {
-    bool chunked = m_headers.value("Transfer-Encoding").toLower() == "chunked" ;
+    bool chunked = isChunked();
     if (chunked && data.size() > 0) {
         if (!m_sentHeaders) {
             writeHeaders();
             }
-        m_dataBody += QByteArray::number(data.size(),16) ;
-        m_dataBody += "\r\n";
-        m_dataBody += data;
-        m_dataBody += "\r\n";
+        HttpGZipStream *stream = m_connection->gzipStream();
+        appendChunk((stream != NULL) ? stream->compress(data) : data);
         m_canWriteToSocket = true;
-        m_writerTimer->setInterval(0);
-        m_writerTimer->start();
+        scheduleWrite();
         return;
         }
 
@@ -187,19 +283,131 @@ void HttpResponse::write(const QByteArray& data) {
             qDebug() << "You could not write to HttpRespose when the response is flushed. Data written are ignored.";
             return;
             }
-        m_closeAfterFlush = true;
+        if (!m_bodyParts.isEmpty()) {
+            BodyPart part;
+            part.data = data;
+            part.offset = 0;
+            part.length = -1;
+            m_bodyParts << part;
+            m_bodyPartsSize += data.size();
+            return;
+            }
         m_dataBody += data;
         }
 
 }
 
 
+void HttpResponse::writeFile(const QString& path, qint64 offset, qint64 length) {
+    if (m_flushed || isChunked()) {
+        qDebug() << "You could not write a file to flushed or chunked HttpRespose. Data written are ignored.";
+        return;
+        }
+    if (length <= 0) { return; }
+    BodyPart part;
+    part.path = path;
+    part.offset = offset;
+    part.length = length;
+    m_bodyParts << part;
+    m_bodyPartsSize += length;
+}
+
+
+/**
+ * @brief Moves next block of the body to the write buffer
+ *
+ * Content-Length of the response is sent already, the connection is aborted
+ * when the file cannot be read.
+ *
+ * @returns false if the file cannot be read
+ */
+bool HttpResponse::readBodyPart() {
+    BodyPart& part = m_bodyParts.first();
+    if (part.length < 0) {
+        m_dataBody = part.data;
+        m_bodyPartsSize -= part.data.size();
+        m_bodyParts.removeFirst();
+        return true;
+        }
+
+    if (m_file.fileName() != part.path || !m_file.isOpen()) {
+        m_file.close();
+        m_file.setFileName(part.path);
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            qWarning("HttpResponse: cannot read %s", qPrintable(part.path));
+            return false;
+            }
+        }
+
+    qint64 size = qMin(part.length, (qint64)FILE_BLOCK_SIZE);
+    if (!m_file.seek(part.offset)) {
+        return false;
+        }
+    m_dataBody = m_file.read(size);
+    if (m_dataBody.size() != size) {
+        qWarning("HttpResponse: file %s is shorter than expected", qPrintable(part.path));
+        return false;
+        }
+    part.offset += size;
+    part.length -= size;
+    m_bodyPartsSize -= size;
+    if (part.length <= 0) {
+        m_bodyParts.removeFirst();
+        }
+    return true;
+}
+
+
+void HttpResponse::appendChunk(const QByteArray& data) {
+    if (data.isEmpty()) { return; }
+    m_dataBody += QByteArray::number(data.size(),16) ;
+    m_dataBody += "\r\n";
+    m_dataBody += data;
+    m_dataBody += "\r\n";
+}
+
+
+/**
+ * @brief Writes the unwritten part of the buffer to the socket, returns true when the whole buffer is written
+ *
+ * The data are passed to the socket directly from the buffer, the remaining part is not copied.
+ * Written buffer is released and the pointer is reset, so the buffer of a long chunked
+ * response does not grow with every chunk sent.
+ */
+bool HttpResponse::writeBuffer(QByteArray& buffer, int& pointer) {
+    if (buffer.size() > pointer) {
+        qint64 written = m_socket->write(buffer.constData() + pointer, buffer.size() - pointer);
+        if (written > 0) {
+            pointer += written;
+            m_connection->writeProgress();
+            }
+        if (buffer.size() > pointer) {
+            return false;
+            }
+        }
+    buffer.clear();
+    pointer = 0;
+    return true;
+}
+
+
 void HttpResponse::flush() {
     m_flushed = true;
     if (!isConnected()) { return; }
     m_canWriteToSocket = true;
-    m_writerTimer->setInterval(0);
-    m_writerTimer->start();
+    scheduleWrite();
+}
+
+
+/**
+ * @brief Calls slotWrite() from the event loop, once for all writes made by the handler in one call
+ *
+ * Next writes are driven by the bytesWritten() signal of the socket.
+ */
+void HttpResponse::scheduleWrite() {
+    if (m_writeScheduled) { return; }
+    m_writeScheduled = true;
+    QMetaObject::invokeMethod(this, "slotWrite", Qt::QueuedConnection);
 }
 
 
@@ -216,30 +424,50 @@ void HttpResponse::flushAndDelete() {
 
 
 void HttpResponse::slotWrite() {
-    if (m_headers.size() > 0 && !m_sentHeaders) {
+    m_writeScheduled = false;
+
+    // Responses to pipelined requests are written in the order of requests,
+    // the connection calls slotWrite() when the previous response is destroyed
+    // or when the previous chunk of an event stream is written
+    if (!m_connection->isCurrentResponse(this)) { return; }
+
+    // Regular response is complete when flushed, Content-Length is known then
+    bool chunked = isChunked();
+    if (!chunked && !m_flushed) { return; }
+
+    if ((m_headers.size() > 0 || m_statusCode < 200) && !m_sentHeaders) {
         m_canWriteToSocket = true;
         writeHeaders();
         }
-    if (!m_canWriteToSocket) { goto konec; }
-    if (m_socket->bytesToWrite() > 0) { goto konec; }
-    if (!isConnected()) { goto konec; }
-    if (m_socket->isOpen() != true) { goto konec; }
-    if (m_socket->isWritable() != true) { goto konec; }
-    if (m_dataHeaders.size() > m_dataHeadersPointer) {
-        m_dataHeadersPointer += m_socket->write(m_dataHeaders.mid(m_dataHeadersPointer));
-        if (m_dataHeaders.size() > m_dataHeadersPointer) { goto konec; }
+    // Returns here are not lost, slotWrite() is called again from bytesWritten() signal
+    if (!m_canWriteToSocket) { return; }
+    if (m_socket->bytesToWrite() > 0) { return; }
+    if (!isConnected()) { return; }
+    if (m_socket->isOpen() != true) { return; }
+    if (m_socket->isWritable() != true) { return; }
+    if (!writeBuffer(m_dataHeaders, m_dataHeadersPointer)) { return; }
+    if (!writeBuffer(m_dataBody, m_dataBodyPointer)) { return; }
+
+    // Parts of files are read in blocks, next block is read when the socket has written the previous one
+    if (!m_bodyParts.isEmpty()) {
+        if (!readBodyPart()) {
+            m_bodyParts.clear();
+            m_socket->abort();
+            return;
+            }
+        writeBuffer(m_dataBody, m_dataBodyPointer);
+        return;
         }
 
-    if (m_dataBody.size() > m_dataBodyPointer) {
-        m_dataBodyPointer += m_socket->write(m_dataBody.mid(m_dataBodyPointer));
-        if (m_dataBody.size() > m_dataBodyPointer) { goto konec; }
+    // Written chunk of an event stream, the next response can write its chunk
+    if (chunked && m_sentHeaders) {
+        m_connection->writeNextResponse(this);
         }
 
     if (m_dataHeaders.size() <= m_dataHeadersPointer &&
         m_dataBody.size() <= m_dataBodyPointer &&
         m_closeAfterFlush) {
         m_socket->flush();
-        m_writerTimer->stop();
         close();
         return;
         }
@@ -248,14 +476,23 @@ void HttpResponse::slotWrite() {
         m_dataBody.size() <= m_dataBodyPointer &&
         m_deleteAfterFlush) {
         m_socket->flush();
-        m_writerTimer->stop();
         deleteLater();
         return;
         }
 
-  konec:
-    m_writerTimer->setInterval(100);
-    m_writerTimer->start();
+    // Complete regular response, the connection stays open for next requests
+    if (m_dataHeaders.size() <= m_dataHeadersPointer &&
+        m_dataBody.size() <= m_dataBodyPointer &&
+        !chunked && m_flushed) {
+        m_socket->flush();
+        if (!m_keepAlive && m_statusCode >= 200) {
+            close();
+            return;
+            }
+        deleteLater();
+        return;
+        }
+
 }
 
 
@@ -9,15 +9,16 @@
 #define _HttpResponse_H_
 
 #include <QMap>
+#include <QFile>
 #include <QObject>
 #include <QString>
 #include <QTcpSocket>
-#include <QTimer>
 #include "httpcookie.h"
 
 namespace HobrasoftHttpd {
 class HttpConnection;
 class HttpCookie;
+class HttpRequest;
 
 /**
  * @brief Response to HTTP request - headers, cookies and body
@@ -34,8 +35,16 @@ class HttpResponse : public QObject {
 
     /**
      * @brief Constructor sets default values for headers (status 200, OK)
+     *
+     * @param connection - connection to write the response to
+     * @param request - request the response answers, it decides whether the connection is kept open
+     */
+    HttpResponse(HttpConnection *connection, HttpRequest *request = NULL);
+
+    /**
+     * @brief Returns the request answered by the response or NULL
      */
-    HttpResponse(HttpConnection *);
+    HttpRequest *request() const { return m_request; }
 
     /**
      * @brief Sets or rewrite one header
@@ -78,11 +87,36 @@ class HttpResponse : public QObject {
      */
     HttpCookie cookie(const QString& name) { return m_cookies.value(name); }
 
+    /**
+     * @brief Returns true if the response does not hold back the next response on the connection
+     *
+     * Running chunked response (its headers are sent and its data written) lets the next
+     * responses write chunks of the event stream. Response which was not used yet (the default
+     * response of an event stream handler) does not hold back chunked responses to the same request.
+     * Other responses must be complete before the next response is written.
+     */
+    bool yieldsTo(HttpResponse *next);
+
     /**
      * @brief Set the status code and the description of the response
      */
     void setStatus(int code, const QString& description = QString());
 
+    /**
+     * @brief Returns the status code of the response
+     */
+    int statusCode() const { return m_statusCode; }
+
+    /**
+     * @brief Sets the MD5 digest of the body written to the response
+     *
+     * When the digest is set, compressed body is taken from HttpContentCache
+     * and the body is compressed only once for all responses of the same content.
+     * The digest should be set only for the content which does not change
+     * between requests (static files).
+     */
+    void setContentDigest(const QByteArray& digest) { m_contentDigest = digest; }
+
     /**
      * @brief Writes data to response body
      *
@@ -93,6 +127,19 @@ class HttpResponse : public QObject {
      */
     void write(const QByteArray& data);
 
+    /**
+     * @brief Writes a part of the file to response body
+     *
+     * The part is not read at once, it is read in blocks of 64 kB when the socket
+     * has written the previous block. Data written after this call follow the part.
+     * Only regular (not chunked) responses are supported, the body is not compressed.
+     *
+     * @param path - path of the file
+     * @param offset - first byte of the part
+     * @param length - number of bytes, the file must not be truncated before the response is written
+     */
+    void writeFile(const QString& path, qint64 offset, qint64 length);
+
 
     /**
      * @brief Flushed sockets data to network
@@ -104,7 +151,9 @@ class HttpResponse : public QObject {
      * @brief Writes last part of the response and closes the socket when possible
      *
      * When sending chunked response the last chunk is written (zero length), in
-     * other case the socket is closed.
+     * other case the response is complete. The socket is closed after the response
+     * when the client does not keep the connection alive, otherwise the response is
+     * destroyed and the connection waits for next request.
      *
      * Closing socket destroys the HttpConnection and HttpResponse classes.
      */
@@ -134,7 +183,8 @@ class HttpResponse : public QObject {
     /**
      * @brief Closes socket and destroys connection. Should by called only when "chunked" transport is choosen
      *
-     * Call flush() befor the close;
+     * Call flush() befor the close; When the chunked response is compressed, the end
+     * of gzip stream is written in the last chunk.
      */
     void close();
 
@@ -145,6 +195,7 @@ class HttpResponse : public QObject {
     #ifndef DOXYGEN_SHOULD_SKIP_THIS
     QTcpSocket *m_socket;
     HttpConnection *m_connection;
+    HttpRequest    *m_request;
 
     QMap<QString, QString>      m_headers;
     QMap<QString, HttpCookie>   m_cookies;
@@ -156,10 +207,15 @@ class HttpResponse : public QObject {
 
     void    writeToSocket(const QByteArray& data); /// blocks!!! ??
     void    writeHeaders();
-
-    QTimer     *m_writerTimer;
+    void    appendChunk(const QByteArray& data);
+    bool    isChunked();
+    void    scheduleWrite();
+    bool    writeBuffer(QByteArray& buffer, int& pointer);
+    bool    readBodyPart();
+    void    setEncodedEntityTag(const QByteArray& encoding);
 
     QByteArray  m_dataBody;
+    QByteArray  m_contentDigest;
     QByteArray  m_dataHeaders;
     int         m_dataBodyPointer;
     int         m_dataHeadersPointer;
@@ -167,6 +223,23 @@ class HttpResponse : public QObject {
     bool        m_closeAfterFlush;
     bool        m_deleteAfterFlush;
     bool        m_flushed;
+    bool        m_writeScheduled;
+    bool        m_keepAlive;
+    bool        m_chunked;
+    bool        m_chunkedValid;
+
+    /**
+     * @brief Body written after a part of a file, data (length < 0) or next part of a file
+     */
+    struct BodyPart {
+        QByteArray  data;
+        QString     path;
+        qint64      offset;
+        qint64      length;
+    };
+    QList<BodyPart> m_bodyParts;
+    qint64      m_bodyPartsSize;
+    QFile       m_file;
     #endif
 };
 
@@ -13,6 +13,7 @@
 #include "httpconnection.h"
 #include "httprequesthandler.h"
 #include "httptcpserver.h"
+#include "httpcontentcache.h"
 #include <QSslSocket>
 #include <QPointer>
 #include <QThread>
@@ -22,12 +23,16 @@ using namespace HobrasoftHttpd;
 
 HttpServer::HttpServer(QObject *parent) : QObject(parent) {
     m_server = NULL;
+    m_connectionCount = 0;
+    m_refusedConnections = 0;
     m_settings = new HttpSettings(this);
 }
 
 
 HttpServer::HttpServer(const HttpSettings *settings, QObject *parent) : QObject(parent) {
     m_server = NULL;
+    m_connectionCount = 0;
+    m_refusedConnections = 0;
     m_settings = settings;
 }
 
@@ -42,6 +47,8 @@ void HttpServer::close() {
 void HttpServer::start() {
     QHostAddress address = m_settings->address();
     int             port = m_settings->port();
+
+    HttpContentCache::setMaxSize(m_settings->cacheSize());
     
     if (m_server != NULL) {
         m_server->close();
@@ -70,6 +77,13 @@ void HttpServer::start() {
 }
 
 
+void HttpServer::reloadSslConfiguration() {
+    if (m_server != NULL) {
+        m_server->reloadSslConfiguration();
+        }
+}
+
+
 HttpRequestHandler *HttpServer::requestHandler(HttpConnection *parent) {
     return new HttpRequestHandler(parent);
 }
@@ -79,10 +93,18 @@ void HttpServer::slotNewConnection() {
     bool threads = m_settings->threads();
     while (m_server->hasPendingConnections()) {
         QTcpSocket *socket = m_server->nextPendingConnection();
+        // TLS connections were counted by HttpTcpServer before the handshake
+        if (!m_settings->useSSL() && !reserveConnection(socket->peerAddress())) {
+            refuseConnection(socket);
+            continue;
+            }
+
         QPointer<HttpConnection> connection = new HttpConnection(this, socket);
         socket->setParent(connection);
         connection->setPeerCertificate(m_server->peerCertificate(socket));
         connection->setVerified(m_server->verified(socket));
+        connect(connection, SIGNAL(destroyed(QObject *)),
+                this,         SLOT(slotConnectionClosed(QObject *)));
 
         if (threads) {
             QThread *thread = new QThread(this);
@@ -91,8 +113,6 @@ void HttpServer::slotNewConnection() {
             m_connections << connection;
             connection->setParent(0);
             connection->moveToThread(thread);
-            connect(connection, SIGNAL(destroyed(QObject *)),
-                    this,         SLOT(slotConnectionClosed(QObject *)));
             connect(connection, SIGNAL(destroyed(QObject *)),
                     thread,       SLOT(quit()));
             connect(thread, SIGNAL(finished()),
@@ -102,6 +122,29 @@ void HttpServer::slotNewConnection() {
 }
 
 
+/**
+ * @brief Answers the connection with 503 response and closes it
+ *
+ * The response is written directly to the socket, no HttpConnection
+ * and no request handler is created.
+ */
+void HttpServer::refuseConnection(QTcpSocket *socket) {
+    socket->setParent(this);
+    if (socket->state() != QAbstractSocket::ConnectedState) {
+        socket->deleteLater();
+        return;
+        }
+    connect(socket, SIGNAL(disconnected()),
+            socket,   SLOT(deleteLater()));
+    socket->write("HTTP/1.1 503 Service Unavailable\r\n");
+    socket->write("Retry-After: " + QByteArray::number(m_settings->retryAfter()) + "\r\n");
+    socket->write("Connection: close\r\n");
+    socket->write("Content-Length: 0\r\n");
+    socket->write("\r\n");
+    socket->disconnectFromHost();
+}
+
+
 void HttpServer::slotConnectionClosed(QObject *object) {
     Q_UNUSED(object);
     // QPointer<HttpConnection> connection = qobject_cast<HobrasoftHttpd::HttpConnection*>(object);
@@ -111,6 +154,69 @@ void HttpServer::slotConnectionClosed(QObject *object) {
 }
 
 
+void HttpServer::peerClosed(const QHostAddress& peer) {
+    QMetaObject::invokeMethod(this, "slotPeerClosed", Qt::QueuedConnection, Q_ARG(QString, peer.toString()));
+}
+
+
+bool HttpServer::reserveConnection(const QHostAddress& address) {
+    int maxConnections = m_settings->maxConnections();
+    int maxConnectionsPerPeer = m_settings->maxConnectionsPerPeer();
+    QString peer = address.toString();
+    if ((maxConnections > 0 && m_connectionCount >= maxConnections) ||
+        (maxConnectionsPerPeer > 0 && m_peerConnections.value(peer) >= maxConnectionsPerPeer) ||
+        isOverloaded()) {
+        m_refusedConnections++;
+        return false;
+        }
+    m_connectionCount++;
+    m_peerConnections[peer]++;
+    return true;
+}
+
+
+void HttpServer::slotPeerClosed(const QString& peer) {
+    m_connectionCount--;
+    if (--m_peerConnections[peer] <= 0) {
+        m_peerConnections.remove(peer);
+        }
+}
+
+
+bool HttpServer::isOverloaded() const {
+    int maxInFlightRequests = m_settings->maxInFlightRequests();
+    if (maxInFlightRequests > 0 && m_inFlightRequests.load() > maxInFlightRequests) {
+        return true;
+        }
+    int maxBufferedBytes = m_settings->maxBufferedBytes();
+    if (maxBufferedBytes > 0 && m_bufferedBytes.load() > maxBufferedBytes) {
+        return true;
+        }
+    return false;
+}
+
+
+QVariantMap HttpServer::loadStatus() const {
+    QVariantMap data;
+    data["connections"]         = m_connectionCount;
+    data["peers"]               = m_peerConnections.size();
+    data["inFlightRequests"]    = m_inFlightRequests.load();
+    data["bufferedBytes"]       = m_bufferedBytes.load();
+    data["refusedConnections"]  = m_refusedConnections;
+    data["refusedRequests"]     = m_refusedRequests.load();
+    data["timedOutRequests"]    = m_timedOutRequests.load();
+    return data;
+}
+
+
+QVariantMap HttpServer::sslStatus() const {
+    if (m_server == NULL) {
+        return QVariantMap();
+        }
+    return m_server->handshakeStatus();
+}
+
+
 QVariant HttpServer::webStatus() const {
     QVariantList objectlist;
     QObjectList list = children();
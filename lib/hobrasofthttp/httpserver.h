@@ -18,6 +18,9 @@
 #include <QSslError>
 #include <QSet>
 #include <QPointer>
+#include <QVariantMap>
+#include <QAtomicInt>
+#include <QHash>
 #include "testsettings.h"
 
 namespace HobrasoftHttpd {
@@ -124,8 +127,86 @@ class HttpServer : public QObject {
 
     QVariant webStatus() const;
 
+    /**
+     * @brief Returns counters of TLS handshakes
+     *
+     * @see HttpTcpServer::handshakeStatus()
+     */
+    QVariantMap sslStatus() const;
+
+    /**
+     * @brief Returns counters of admission control
+     *
+     * - connections - number of open connections, including TLS handshakes in progress
+     * - peers - number of client addresses with open connections
+     * - inFlightRequests - requests read and not answered yet
+     * - bufferedBytes - received and unsent data buffered in connections
+     * - refusedConnections - connections over the limits, answered with 503 response (closed before the TLS handshake)
+     * - refusedRequests - requests answered with 503 response
+     * - timedOutRequests - requests closed because their headers or body were received too slowly
+     */
+    QVariantMap loadStatus() const;
+
+    /**
+     * @brief Returns true if the limit of in-flight requests or buffered data is exceeded
+     *
+     * New requests are refused with 503 response. Thread safe, called by HttpConnection.
+     */
+    bool isOverloaded() const;
+
+    /**
+     * @brief Counts the request read by a connection, thread safe
+     */
+    void requestStarted() { m_inFlightRequests.ref(); }
+
+    /**
+     * @brief Counts the request deleted by a connection, thread safe
+     */
+    void requestFinished() { m_inFlightRequests.deref(); }
+
+    /**
+     * @brief Counts the request refused with 503 response, thread safe
+     */
+    void requestRefused() { m_refusedRequests.ref(); }
+
+    /**
+     * @brief Counts the request not received in time, thread safe
+     */
+    void requestTimedOut() { m_timedOutRequests.ref(); }
+
+    /**
+     * @brief Adds the change of data buffered in a connection, thread safe
+     */
+    void addBufferedBytes(int x) { m_bufferedBytes.fetchAndAddRelaxed(x); }
+
+    /**
+     * @brief Counts new connection of the peer, returns false if the connection is over the limits
+     *
+     * The connection is counted in open connections until peerClosed() is called.
+     * Connections over maxConnections(), maxConnectionsPerPeer() or refused
+     * because of isOverloaded() are counted as refused. Called in the thread of the server.
+     */
+    bool reserveConnection(const QHostAddress& peer);
+
+    /**
+     * @brief Counts the closed connection of the peer, thread safe
+     *
+     * Called from the HttpConnection destructor and by HttpTcpServer for TLS handshakes
+     * which did not complete.
+     */
+    void peerClosed(const QHostAddress& peer);
+
     QList<QPointer<HobrasoftHttpd::HttpConnection> >   connections() const { return m_connections; }
 
+  public slots:
+    /**
+     * @brief Reads SSL key and certificates again, the new configuration is used for new connections
+     *
+     * The files are reloaded automatically when they change. The slot can be connected
+     * to a signal of the application (SIGHUP handler for example).
+     */
+    void            reloadSslConfiguration();
+
   signals:
     void started();
     void couldNotStart();
@@ -148,12 +229,22 @@ class HttpServer : public QObject {
 
 
     void            slotConnectionClosed(QObject *);
+    void            slotPeerClosed(const QString&);
 
   private:
     #ifndef DOXYGEN_SHOULD_SKIP_THIS
+    void                 refuseConnection(QTcpSocket *);
+
     HttpTcpServer       *m_server;
     const HttpSettings  *m_settings;
     QList<QPointer<HobrasoftHttpd::HttpConnection> > m_connections;
+    int                  m_connectionCount;
+    QHash<QString, int>  m_peerConnections;
+    int                  m_refusedConnections;
+    QAtomicInt           m_inFlightRequests;
+    QAtomicInt           m_bufferedBytes;
+    QAtomicInt           m_refusedRequests;
+    QAtomicInt           m_timedOutRequests;
     #endif
 
 };
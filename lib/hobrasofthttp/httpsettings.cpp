@@ -17,9 +17,20 @@
  * - __httpd/address__ - bind address for http server (::)
  * - __httpd/port__ - bind port for http server (8080)
  * - __httpd/timeout__ - timeout for http request (600 sec)
+ * - __httpd/headerTimeout__ - time limit for request line and headers, it is not extended by received data (30 sec)
+ * - __httpd/minBodyRate__ - minimum transfer rate of request body in bytes per second after headerTimeout grace period (512, 0 - unlimited)
  * - __httpd/maxAge__ - maximum age for browser cache or caching proxy server for static files (3600 sec)
+ * - __httpd/immutableMaxAge__ - maximum age for fingerprinted static files, sent with immutable directive (31536000 sec)
+ * - __httpd/immutablePattern__ - regular expression matching names of fingerprinted files, app.3f2a9c1b.js (`[.-](?=[0-9a-f]*[a-f])[0-9a-f]{8,}\.[^./]+$`), the hash must contain a letter so that dates and counters (report-20240101.json) do not match
+ * - __httpd/cacheSize__ - size of the cache for static files and their compressed variants in bytes (16777216)
+ * - __httpd/maxCachedFileSize__ - larger files are not stored in the cache (1048576)
  * - __httpd/maxRequestSize__ - maximum size of request (16384)
  * - __httpd/maxMultiPartSize__ - maximum size of multipart request (1048576)
+ * - __httpd/maxConnections__ - maximum number of open connections, new connections get 503 response (0 - unlimited)
+ * - __httpd/maxConnectionsPerPeer__ - maximum number of open connections from one client address, new connections get 503 response (0 - unlimited)
+ * - __httpd/maxInFlightRequests__ - maximum number of requests read and not answered yet, next requests get 503 response (0 - unlimited)
+ * - __httpd/maxBufferedBytes__ - maximum size of received and unsent data buffered in all connections in bytes, new requests get 503 response (0 - unlimited)
+ * - __httpd/retryAfter__ - value of Retry-After header sent with 503 responses (5 sec)
  * - __httpd/sessionExpirationTime__ - session timeout (3600 sec)
  * - __httpd/sessionCookieName__ - session cookie name (sessionid)
  * - __httpd/encoding__ - encoding set in headers (UTF-8)
@@ -30,6 +41,7 @@
  * - __httpd/sslKey__  - path to SSL key file in PEM format
  * - __httpd/sslCrt__  - path to SSL certificate file in PEM format
  * - __httpd/sslCaCrt__  - path to SSL CA certificate file in PEM format
+ * - __httpd/sslSessionTickets__ - issue TLS session tickets (false), Qt creates new SSL context for each connection and tickets cannot be used for resumption
  * - __httpd/threads__  - when true then new thread is started for each connection
  *
  * SSL errors
@@ -81,7 +93,13 @@ void HttpSettings::setDefaultValues() {
     m_port                  = 8080;
     m_address               = QHostAddress::Any;
     m_timeout               = 600;
+    m_headerTimeout         = 30;
+    m_minBodyRate           = 512;
     m_maxAge                = 3600;
+    m_immutableMaxAge       = 31536000;
+    m_immutablePattern.setPattern("[.-](?=[0-9a-f]*[a-f])[0-9a-f]{8,}\\.[^./]+$");
+    m_cacheSize             = 16777216;
+    m_maxCachedFileSize     = 1048576;
     m_encoding              = "UTF-8";
     m_docroot               = ".";
     m_indexFile             = "index.html";
@@ -89,14 +107,26 @@ void HttpSettings::setDefaultValues() {
     m_sessionExpirationTime = 3600;
     m_maxRequestSize        = 16384;
     m_maxMultiPartSize      = 16728064;
+    m_maxConnections        = 0;
+    m_maxConnectionsPerPeer = 0;
+    m_maxInFlightRequests   = 0;
+    m_maxBufferedBytes      = 0;
+    m_retryAfter            = 5;
     m_useSSL                = false;
+    m_sslSessionTickets     = false;
     m_threads               = false;
 
     m_default_section2 = "http";
     m_default_port = 8080;
     m_default_address = QHostAddress::Any;
     m_default_timeout = 600;
+    m_default_headerTimeout = 30;
+    m_default_minBodyRate = 512;
     m_default_maxAge = 3600;
+    m_default_immutableMaxAge = 31536000;
+    m_default_immutablePattern = "[.-](?=[0-9a-f]*[a-f])[0-9a-f]{8,}\\.[^./]+$";
+    m_default_cacheSize = 16777216;
+    m_default_maxCachedFileSize = 1048576;
     m_default_encoding = "UTF-8";
     m_default_docroot = ".";
     m_default_indexFile = "index.html";
@@ -104,10 +134,16 @@ void HttpSettings::setDefaultValues() {
     m_default_sessionExpirationTime = 3600;
     m_default_maxRequestSize = 16384;
     m_default_maxMultiPartSize = 16728064;
+    m_default_maxConnections = 0;
+    m_default_maxConnectionsPerPeer = 0;
+    m_default_maxInFlightRequests = 0;
+    m_default_maxBufferedBytes = 0;
+    m_default_retryAfter = 5;
     m_default_useSSL = false;
     m_default_sslKey = "";
     m_default_sslCrt = "";
     m_default_sslCaCrt = "";
+    m_default_sslSessionTickets = false;
     m_default_ignoreAllSslErrors = true;
     m_default_threads = true;
 }
@@ -134,8 +170,21 @@ void HttpSettings::readSettings(const QSettings *settings, const QString& sectio
         }
     m_timeout               = settings->value(  section  + "/timeout",
                               settings->value(m_section2 + "/timeout",               m_default_timeout)).toInt();
+    m_headerTimeout         = settings->value(  section  + "/headerTimeout",
+                              settings->value(m_section2 + "/headerTimeout",         m_default_headerTimeout)).toInt();
+    m_minBodyRate           = settings->value(  section  + "/minBodyRate",
+                              settings->value(m_section2 + "/minBodyRate",           m_default_minBodyRate)).toInt();
     m_maxAge                = settings->value(  section  + "/maxAge", 
                               settings->value(m_section2 + "/maxAge",                m_default_maxAge)).toInt();
+    m_immutableMaxAge       = settings->value(  section  + "/immutableMaxAge",
+                              settings->value(m_section2 + "/immutableMaxAge",       m_default_immutableMaxAge)).toInt();
+    m_immutablePattern.setPattern(
+                              settings->value(  section  + "/immutablePattern",
+                              settings->value(m_section2 + "/immutablePattern",      m_default_immutablePattern)).toString());
+    m_cacheSize             = settings->value(  section  + "/cacheSize",
+                              settings->value(m_section2 + "/cacheSize",             m_default_cacheSize)).toInt();
+    m_maxCachedFileSize     = settings->value(  section  + "/maxCachedFileSize",
+                              settings->value(m_section2 + "/maxCachedFileSize",     m_default_maxCachedFileSize)).toInt();
     m_encoding              = settings->value(  section  + "/encoding", 
                               settings->value(m_section2 + "/encoding",              m_default_encoding)).toString();
     m_docroot               = settings->value(  section  + "/root", 
@@ -150,6 +199,16 @@ void HttpSettings::readSettings(const QSettings *settings, const QString& sectio
                               settings->value(m_section2 + "/maxRequestSize",        m_default_maxRequestSize)).toInt();
     m_maxMultiPartSize      = settings->value(  section  + "/maxMultiPartSize", 
                               settings->value(m_section2 + "/maxMultiPartSize",      m_default_maxMultiPartSize)).toInt();
+    m_maxConnections        = settings->value(  section  + "/maxConnections",
+                              settings->value(m_section2 + "/maxConnections",        m_default_maxConnections)).toInt();
+    m_maxConnectionsPerPeer = settings->value(  section  + "/maxConnectionsPerPeer",
+                              settings->value(m_section2 + "/maxConnectionsPerPeer", m_default_maxConnectionsPerPeer)).toInt();
+    m_maxInFlightRequests   = settings->value(  section  + "/maxInFlightRequests",
+                              settings->value(m_section2 + "/maxInFlightRequests",   m_default_maxInFlightRequests)).toInt();
+    m_maxBufferedBytes      = settings->value(  section  + "/maxBufferedBytes",
+                              settings->value(m_section2 + "/maxBufferedBytes",      m_default_maxBufferedBytes)).toInt();
+    m_retryAfter            = settings->value(  section  + "/retryAfter",
+                              settings->value(m_section2 + "/retryAfter",            m_default_retryAfter)).toInt();
     m_useSSL                = settings->value(  section  + "/useSSL",
                               settings->value(m_section2 + "/useSSL",                m_default_useSSL)).toBool();
     m_sslKey                = settings->value(  section  + "/sslKey",
@@ -158,6 +217,8 @@ void HttpSettings::readSettings(const QSettings *settings, const QString& sectio
                               settings->value(m_section2 + "/sslCrt",                m_default_sslCrt)).toString();
     m_sslCaCrt              = settings->value(  section  + "/sslCaCrt",
                               settings->value(m_section2 + "/sslCaCrt",              m_default_sslCaCrt)).toString();
+    m_sslSessionTickets     = settings->value(  section  + "/sslSessionTickets",
+                              settings->value(m_section2 + "/sslSessionTickets",     m_default_sslSessionTickets)).toBool();
     m_ignoreAllSslErrors    = settings->value(  section  + "/IgnoreAllSslErrors",
                               settings->value(m_section2 + "/IgnoreAllSslErrors",    m_default_ignoreAllSslErrors)).toBool();
     m_threads               = settings->value(  section  + "/threads",              
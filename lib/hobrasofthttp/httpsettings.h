@@ -9,6 +9,7 @@
 
 #include <QHostAddress>
 #include <QSettings>
+#include <QRegularExpression>
 #include <QSslError>
 #include <QSet>
 
@@ -69,10 +70,34 @@ class HttpSettings : public QObject {
     void            setTimeout(int x) { m_timeout = x; }                                    ///< Sets timeout for opened connection from clients
     void            setDefaultTimeout(int x) { m_default_timeout = x; }                     ///< Sets default timeout for opened connection from clients
 
+    int             headerTimeout() const { return m_headerTimeout; }                       ///< Returns time limit for reading request line and headers
+    void            setHeaderTimeout(int x) { m_headerTimeout = x; }                        ///< Sets time limit for reading request line and headers
+    void            setDefaultHeaderTimeout(int x) { m_default_headerTimeout = x; }         ///< Sets default time limit for reading request line and headers
+
+    int             minBodyRate() const { return m_minBodyRate; }                           ///< Returns minimum transfer rate of request body in bytes per second
+    void            setMinBodyRate(int x) { m_minBodyRate = x; }                            ///< Sets minimum transfer rate of request body
+    void            setDefaultMinBodyRate(int x) { m_default_minBodyRate = x; }             ///< Sets default minimum transfer rate of request body
+
     int             maxAge() const { return m_maxAge; }                                     ///< Returns the max age for cacheing proxy  objects 
     void            setMaxAge(int x) { m_maxAge = x; }                                      ///< Sets the max age cacheing proxy  objects
     void            setDefaultMaxAge(int x) { m_default_maxAge = x; }                       ///< Sets the default max age cacheing proxy  objects
 
+    int             immutableMaxAge() const { return m_immutableMaxAge; }                   ///< Returns the max age for fingerprinted files which never change
+    void            setImmutableMaxAge(int x) { m_immutableMaxAge = x; }                    ///< Sets the max age for fingerprinted files which never change
+    void            setDefaultImmutableMaxAge(int x) { m_default_immutableMaxAge = x; }     ///< Sets the default max age for fingerprinted files which never change
+
+    const QRegularExpression& immutablePattern() const { return m_immutablePattern; }       ///< Returns the pattern of fingerprinted (content hashed) file names
+    void            setImmutablePattern(const QString& x) { m_immutablePattern.setPattern(x); } ///< Sets the pattern of fingerprinted file names, empty pattern disables immutable caching
+    void            setDefaultImmutablePattern(const QString& x) { m_default_immutablePattern = x; } ///< Sets the default pattern of fingerprinted file names
+
+    int             cacheSize() const { return m_cacheSize; }                               ///< Returns the size of static content cache in bytes
+    void            setCacheSize(int x) { m_cacheSize = x; }                                ///< Sets the size of static content cache in bytes
+    void            setDefaultCacheSize(int x) { m_default_cacheSize = x; }                 ///< Sets the default size of static content cache in bytes
+
+    int             maxCachedFileSize() const { return m_maxCachedFileSize; }               ///< Returns maximum size of a file stored in the cache
+    void            setMaxCachedFileSize(int x) { m_maxCachedFileSize = x; }                ///< Sets maximum size of a file stored in the cache
+    void            setDefaultMaxCachedFileSize(int x) { m_default_maxCachedFileSize = x; } ///< Sets default maximum size of a file stored in the cache
+
     const QString&  encoding() const { return m_encoding; }                                 ///< Returns the encoding in COntent-type header
     void            setEncoding(const QString& x) { m_encoding = x; }                       ///< Sets the encoding in COntent-type header
     void            setDefaultEncoding(const QString& x) { m_default_encoding = x; }        ///< Sets the default encoding in COntent-type header
@@ -101,6 +126,26 @@ class HttpSettings : public QObject {
     void            setMaxMultiPartSize(int x) { m_maxMultiPartSize = x; }                  ///< Sets maximum request size in multipart requests
     void            setDefaultMaxMultiPartSize(int x) { m_default_maxMultiPartSize = x; }   ///< Sets default maximum request size in multipart requests
 
+    int             maxConnections() const { return m_maxConnections; }                     ///< Returns maximum number of open connections, 0 is unlimited
+    void            setMaxConnections(int x) { m_maxConnections = x; }                      ///< Sets maximum number of open connections
+    void            setDefaultMaxConnections(int x) { m_default_maxConnections = x; }       ///< Sets default maximum number of open connections
+
+    int             maxConnectionsPerPeer() const { return m_maxConnectionsPerPeer; }       ///< Returns maximum number of open connections from one address, 0 is unlimited
+    void            setMaxConnectionsPerPeer(int x) { m_maxConnectionsPerPeer = x; }        ///< Sets maximum number of open connections from one address
+    void            setDefaultMaxConnectionsPerPeer(int x) { m_default_maxConnectionsPerPeer = x; } ///< Sets default maximum number of open connections from one address
+
+    int             maxInFlightRequests() const { return m_maxInFlightRequests; }           ///< Returns maximum number of requests being processed, 0 is unlimited
+    void            setMaxInFlightRequests(int x) { m_maxInFlightRequests = x; }            ///< Sets maximum number of requests being processed
+    void            setDefaultMaxInFlightRequests(int x) { m_default_maxInFlightRequests = x; } ///< Sets default maximum number of requests being processed
+
+    int             maxBufferedBytes() const { return m_maxBufferedBytes; }                 ///< Returns maximum size of data buffered in all connections, 0 is unlimited
+    void            setMaxBufferedBytes(int x) { m_maxBufferedBytes = x; }                  ///< Sets maximum size of data buffered in all connections
+    void            setDefaultMaxBufferedBytes(int x) { m_default_maxBufferedBytes = x; }   ///< Sets default maximum size of data buffered in all connections
+
+    int             retryAfter() const { return m_retryAfter; }                             ///< Returns value of Retry-After header of 503 responses
+    void            setRetryAfter(int x) { m_retryAfter = x; }                              ///< Sets value of Retry-After header of 503 responses
+    void            setDefaultRetryAfter(int x) { m_default_retryAfter = x; }               ///< Sets default value of Retry-After header of 503 responses
+
     const QString&  tempDir() const { return m_tempDir; }                                   ///< Returns path to temporary directory
     void            setTempDir(const QString& x) { m_tempDir = x; }                         ///< Sets path to temporary directory
     void            setDefaultTempDir(const QString& x) { m_default_tempDir = x; }          ///< Sets default path to temporary directory
@@ -125,6 +170,10 @@ class HttpSettings : public QObject {
     void            setSslCaCrt(const QString& x) { m_sslCaCrt = x; }                       ///< Set SSL CA certificate
     void            setDefaultSslCaCrt(const QString& x) { m_default_sslCaCrt = x; }        ///< Set default SSL CA certificate
 
+    bool            sslSessionTickets() const { return m_sslSessionTickets; }               ///< Returns true if TLS session tickets are issued
+    void            setSslSessionTickets(bool x) { m_sslSessionTickets = x; }               ///< Sets issuing of TLS session tickets
+    void            setDefaultSslSessionTickets(bool x) { m_default_sslSessionTickets = x; } ///< Sets default issuing of TLS session tickets
+
 
     bool            ignoreSslError(QSslError error) const;                                  ///< Returns true if the error should be ignored, default true
 
@@ -172,7 +221,13 @@ class HttpSettings : public QObject {
     int             m_port;
     QHostAddress    m_address;
     int             m_timeout;
+    int             m_headerTimeout;
+    int             m_minBodyRate;
     int             m_maxAge;
+    int             m_immutableMaxAge;
+    QRegularExpression m_immutablePattern;
+    int             m_cacheSize;
+    int             m_maxCachedFileSize;
     QString         m_encoding;
     QString         m_docroot;
     QString         m_indexFile;
@@ -180,11 +235,17 @@ class HttpSettings : public QObject {
     int             m_sessionExpirationTime;           ///< Expiration age of session
     int             m_maxRequestSize;
     int             m_maxMultiPartSize;
+    int             m_maxConnections;
+    int             m_maxConnectionsPerPeer;
+    int             m_maxInFlightRequests;
+    int             m_maxBufferedBytes;
+    int             m_retryAfter;
     QString         m_tempDir;
     bool            m_useSSL;
     QString         m_sslKey;
     QString         m_sslCrt;
     QString         m_sslCaCrt;
+    bool            m_sslSessionTickets;
     QSet<QSslError> m_sslErrors;
     bool            m_ignoreAllSslErrors;
     bool            m_threads;
@@ -194,7 +255,13 @@ class HttpSettings : public QObject {
     int             m_default_port;
     QHostAddress    m_default_address;
     int             m_default_timeout;
+    int             m_default_headerTimeout;
+    int             m_default_minBodyRate;
     int             m_default_maxAge;
+    int             m_default_immutableMaxAge;
+    QString         m_default_immutablePattern;
+    int             m_default_cacheSize;
+    int             m_default_maxCachedFileSize;
     QString         m_default_encoding;
     QString         m_default_docroot;
     QString         m_default_indexFile;
@@ -202,11 +269,17 @@ class HttpSettings : public QObject {
     int             m_default_sessionExpirationTime;
     int             m_default_maxRequestSize;
     int             m_default_maxMultiPartSize;
+    int             m_default_maxConnections;
+    int             m_default_maxConnectionsPerPeer;
+    int             m_default_maxInFlightRequests;
+    int             m_default_maxBufferedBytes;
+    int             m_default_retryAfter;
     QString         m_default_tempDir;
     bool            m_default_useSSL;
     QString         m_default_sslKey;
     QString         m_default_sslCrt;
     QString         m_default_sslCaCrt;
+    bool            m_default_sslSessionTickets;
     bool            m_default_ignoreAllSslErrors;
     bool            m_default_threads;
     #endif
@@ -0,0 +1,119 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "httpsslhandshake.h"
+#include "httpsettings.h"
+#include <QSslSocket>
+#include <QThread>
+#include <QDebug>
+
+using namespace HobrasoftHttpd;
+
+
+HttpSslHandshake::HttpSslHandshake(QINTPTR socketDescriptor, const QHostAddress& peer, const QSslConfiguration& configuration, const HttpSettings *settings, QThread *target) : QObject(),
+        m_timeout(this, "slotTimeout") {
+    m_socketDescriptor = socketDescriptor;
+    m_peer = peer;
+    m_configuration = configuration;
+    m_settings = settings;
+    m_target = target;
+    m_socket = NULL;
+    m_verified = true;
+}
+
+
+void HttpSslHandshake::start() {
+    m_clock.start();
+    m_socket = new QSslSocket;
+    if (!m_socket->setSocketDescriptor(m_socketDescriptor)) {
+        qDebug() << "setSocketDescriptor failed";
+        delete m_socket;
+        m_socket = NULL;
+        emit failed(m_peer);
+        deleteLater();
+        return;
+        }
+
+    // Clients which open connections and never finish the handshake do not hold the slots
+    if (m_settings->headerTimeout() > 0) {
+        m_timeout.start(m_settings->headerTimeout() * 1000);
+        }
+
+    connect(m_socket, SIGNAL(encrypted()),
+            this,       SLOT(slotEncrypted()));
+    connect(m_socket, SIGNAL(          sslErrors(const QList<QSslError>&)),
+            this,       SLOT(      slotSslErrors(const QList<QSslError>&)));
+    connect(m_socket, SIGNAL(    peerVerifyError(const QSslError&)),
+            this,       SLOT(slotPeerVerifyError(const QSslError&)));
+    connect(m_socket, SIGNAL(    disconnected()),
+            this,       SLOT(slotDisconnected()));
+
+    m_socket->setSslConfiguration(m_configuration);
+    m_socket->startServerEncryption();
+}
+
+
+/**
+ * @brief The socket is encrypted, it is handed over to the target thread
+ */
+void HttpSslHandshake::slotEncrypted() {
+    m_timeout.stop();
+    QSslSocket *socket = m_socket;
+    m_socket = NULL;
+    disconnect(socket, 0, this, 0);
+    socket->moveToThread(m_target);
+    emit encrypted(socket, m_peer, m_verified, m_clock.elapsed());
+    deleteLater();
+}
+
+
+void HttpSslHandshake::slotDisconnected() {
+    fail();
+}
+
+
+/**
+ * @brief The handshake did not complete within headerTimeout(), the socket is aborted
+ */
+void HttpSslHandshake::slotTimeout() {
+    if (m_socket == NULL) { return; }
+    qDebug() << "SSL handshake timed out" << m_peer.toString();
+    fail();
+}
+
+
+void HttpSslHandshake::fail() {
+    if (m_socket == NULL) { return; }
+    m_timeout.stop();
+    QSslSocket *socket = m_socket;
+    m_socket = NULL;
+    disconnect(socket, 0, this, 0);
+    socket->abort();
+    socket->deleteLater();
+    emit failed(m_peer);
+    deleteLater();
+}
+
+
+void HttpSslHandshake::slotPeerVerifyError(const QSslError& error) {
+    Q_UNUSED(error);
+    m_verified = false;
+}
+
+
+void HttpSslHandshake::slotSslErrors(const QList<QSslError>& errors) {
+    QList<QSslError> ignoreList;
+    for (int i=0; i<errors.size(); i++) {
+        if (m_settings->ignoreSslError(errors[i])) {
+            ignoreList << errors[i];
+            continue;
+            }
+        qDebug() << "sslError" << errors[i].errorString();
+        }
+
+    m_socket->ignoreSslErrors(ignoreList);
+}
+
@@ -0,0 +1,101 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#ifndef _HttpSslHandshake_H_
+#define _HttpSslHandshake_H_
+
+#include <QObject>
+#include <QList>
+#include <QSslError>
+#include <QSslConfiguration>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include "httptcpserver.h"
+#include "httptimerwheel.h"
+
+class QSslSocket;
+class QThread;
+
+namespace HobrasoftHttpd {
+
+class HttpSettings;
+
+/**
+ * @brief Performs the SSL handshake of one incoming connection in a handshake thread
+ *
+ * The object is moved to one of the handshake threads of HttpTcpServer. The socket
+ * is created in that thread, so the CPU expensive part of the handshake runs in parallel
+ * with other handshakes and with the connections served by the server.
+ *
+ * When the connection is encrypted, the socket is moved to the target thread
+ * (the thread of HttpTcpServer) and signal encrypted() is emitted. The handshake
+ * must complete within headerTimeout(), otherwise the socket is aborted and signal
+ * failed() is emitted. The object deletes itself when the handshake ends.
+ */
+class HttpSslHandshake : public QObject {
+    Q_OBJECT
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param socketDescriptor - descriptor of accepted connection
+     * @param peer - address of the peer, reported back in the signals
+     * @param configuration - SSL configuration prepared by HttpTcpServer
+     * @param settings - settings used to decide which SSL errors are ignored
+     * @param target - thread to move the encrypted socket to
+     */
+    HttpSslHandshake(QINTPTR socketDescriptor, const QHostAddress& peer, const QSslConfiguration& configuration, const HttpSettings *settings, QThread *target);
+
+  public slots:
+    /**
+     * @brief Creates the socket and starts the handshake, must be called in the handshake thread
+     */
+    void    start();
+
+  signals:
+    /**
+     * @brief Emitted when the handshake is complete, the socket lives in the target thread
+     *
+     * @param socket - encrypted socket without parent
+     * @param peer - address of the peer
+     * @param verified - false if peer's certificate was not verified
+     * @param msecs - duration of the handshake
+     */
+    void    encrypted(QSslSocket *socket, const QHostAddress& peer, bool verified, qint64 msecs);
+
+    /**
+     * @brief Emitted when the connection is closed or timed out before the handshake completed
+     *
+     * @param peer - address of the peer
+     */
+    void    failed(const QHostAddress& peer);
+
+  private slots:
+    #ifndef DOXYGEN_SHOULD_SKIP_THIS
+    void    slotEncrypted();
+    void    slotSslErrors(const QList<QSslError>&);
+    void    slotPeerVerifyError(const QSslError&);
+    void    slotDisconnected();
+    void    slotTimeout();
+
+  private:
+    void    fail();
+
+    QINTPTR               m_socketDescriptor;
+    QHostAddress          m_peer;
+    QSslConfiguration     m_configuration;
+    const HttpSettings   *m_settings;
+    QThread              *m_target;
+    QSslSocket           *m_socket;
+    QElapsedTimer         m_clock;
+    HttpTimer             m_timeout;
+    bool                  m_verified;
+    #endif
+};
+
+}
+
+#endif
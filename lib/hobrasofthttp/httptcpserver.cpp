@@ -6,20 +6,165 @@
 #include "httptcpserver.h"
 #include "httpserver.h"
 #include "httpsettings.h"
+#include "httpsslhandshake.h"
 #include <QSslSocket>
+#include <QThread>
 #include <QSslCertificate>
+#include <QSslKey>
 #include <QFile>
 #include <QDateTime>
+#include <QHostAddress>
 #include <QDebug>
 
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
 using namespace HobrasoftHttpd;
 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+namespace {
+
+/**
+ * @brief Returns the address of the peer of accepted socket, no socket object is created
+ */
+QHostAddress descriptorPeerAddress(QINTPTR socketDescriptor) {
+    struct sockaddr_storage address;
+    #ifdef Q_OS_WIN
+    int length = sizeof(address);
+    #else
+    socklen_t length = sizeof(address);
+    #endif
+    if (::getpeername(socketDescriptor, (struct sockaddr *)&address, &length) != 0) {
+        return QHostAddress();
+        }
+    return QHostAddress((struct sockaddr *)&address);
+}
+
+}
+#endif
+
+
+/**
+ * @brief Destructor stops the handshake threads
+ */
+HttpTcpServer::~HttpTcpServer() {
+    for (int i=0; i<m_handshakeThreads.size(); i++) {
+        m_handshakeThreads[i]->quit();
+        }
+    for (int i=0; i<m_handshakeThreads.size(); i++) {
+        m_handshakeThreads[i]->wait();
+        delete m_handshakeThreads[i];
+        }
+}
+
 
 /**
  * @brief Constructor creates the class instance
  */
 HttpTcpServer::HttpTcpServer(HttpServer *parent) : QTcpServer(parent) {
+    m_httpServer = parent;
     m_settings = parent->settings();
+    m_sslWatcher = NULL;
+    m_nextHandshakeThread = 0;
+    m_pendingHandshakes = 0;
+    m_handshakes = 0;
+    m_failedHandshakes = 0;
+    m_handshakeTime = 0;
+    if (!m_settings->useSSL()) {
+        return;
+        }
+
+    reloadSslConfiguration();
+
+    // Sockets are passed from handshake threads with queued signal
+    qRegisterMetaType<QSslSocket *>("QSslSocket *");
+    qRegisterMetaType<QHostAddress>("QHostAddress");
+    int count = qMax(1, QThread::idealThreadCount());
+    for (int i=0; i<count; i++) {
+        QThread *thread = new QThread;
+        thread->setObjectName(QString("HttpSslHandshake%1").arg(i));
+        thread->start();
+        m_handshakeThreads << thread;
+        }
+
+    m_sslWatcher = new QFileSystemWatcher(this);
+    connect(m_sslWatcher, SIGNAL(fileChanged(const QString&)),
+            this,           SLOT(slotSslFileChanged(const QString&)));
+    QStringList files;
+    files << m_settings->sslKey() << m_settings->sslCrt() << m_settings->sslCaCrt();
+    for (int i=0; i<files.size(); i++) {
+        if (!files[i].isEmpty() && QFile::exists(files[i])) {
+            m_sslWatcher->addPath(files[i]);
+            }
+        }
+}
+
+
+/**
+ * @brief Reads the private key, local certificate chain and CA certificates
+ *
+ * All certificates in the files are loaded, not only the first one.
+ */
+void HttpTcpServer::reloadSslConfiguration() {
+    QFile keyFile(m_settings->sslKey());
+    if (!keyFile.open(QIODevice::ReadOnly)) {
+        qWarning("HttpTcpServer: cannot read SSL key %s", qPrintable(m_settings->sslKey()));
+        return;
+        }
+    QByteArray keyData = keyFile.readAll();
+    QSslKey key(keyData, QSsl::Rsa, QSsl::Pem);
+    #if QT_VERSION >= 0x050000
+    if (key.isNull()) {
+        key = QSslKey(keyData, QSsl::Ec, QSsl::Pem);
+        }
+    #endif
+    if (key.isNull()) {
+        qWarning("HttpTcpServer: invalid SSL key %s", qPrintable(m_settings->sslKey()));
+        return;
+        }
+
+    QList<QSslCertificate> chain = QSslCertificate::fromPath(m_settings->sslCrt());
+    if (chain.isEmpty()) {
+        qWarning("HttpTcpServer: cannot read SSL certificate %s", qPrintable(m_settings->sslCrt()));
+        return;
+        }
+
+    QList<QSslCertificate> cacerts;
+    if (!m_settings->sslCaCrt().isEmpty()) {
+        cacerts = QSslCertificate::fromPath(m_settings->sslCaCrt());
+        }
+
+    QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
+    configuration.setPrivateKey(key);
+    #if QT_VERSION >= 0x050100
+    configuration.setLocalCertificateChain(chain);
+    #else
+    configuration.setLocalCertificate(chain.first());
+    #endif
+    configuration.setCaCertificates(cacerts);
+
+    // Each QSslSocket gets its own SSL context with its own ticket key,
+    // tickets issued by one connection are never accepted by another one
+    configuration.setSslOption(QSsl::SslOptionDisableSessionTickets, !m_settings->sslSessionTickets());
+    m_sslConfiguration = configuration;
+}
+
+
+/**
+ * @brief Slot is invoked when the key or any certificate file changes
+ *
+ * Files replaced by a new file (certificate renewal) are removed from the watcher,
+ * they are added again.
+ */
+void HttpTcpServer::slotSslFileChanged(const QString& path) {
+    if (!m_sslWatcher->files().contains(path) && QFile::exists(path)) {
+        m_sslWatcher->addPath(path);
+        }
+    reloadSslConfiguration();
 }
 
 
@@ -39,50 +184,32 @@ void HttpTcpServer::incomingConnection(QINTPTR socketDescriptor) {
 
     /**
      * If SSL is on then the original QTcpServer::incomingConnection() is unuseable
-     * and  SSL must be initialized.
+     * and  SSL must be initialized. The handshake is expensive, it is handed over
+     * to one of the handshake threads. The socket is created in that thread.
+     * The configuration is prepared in advance, no file is read here.
+     *
+     * Pending handshake counts to the connection limits of the server. Connection
+     * over the limits is closed, no HTTP response can be sent before the handshake.
      */
-    QSslSocket *socket = new QSslSocket;
-    if (!socket->setSocketDescriptor(socketDescriptor)) {
-        qDebug() << "setSocketDescriptor failed";
-        delete socket;
+    QHostAddress peer = descriptorPeerAddress(socketDescriptor);
+    if (!m_httpServer->reserveConnection(peer)) {
+        QTcpSocket socket;
+        socket.setSocketDescriptor(socketDescriptor);
+        socket.abort();
         return;
         }
 
-    /**
-     * Signals of the QSslSocket are connected to slots to
-     * watch for SSL  errors: slotSslErrors() and slotPeerVerifyError()..
-     * When the SSL handshake is complete and the connection is encrypted() then
-     * the slotEncrypted() is called and signal newConnection() is emited from that slot.
-     */
-    m_verified[socket] = true;
-    connect(socket, SIGNAL(encrypted()),
-            this,     SLOT(slotEncrypted()));
-    connect(socket, SIGNAL(          sslErrors(const QList<QSslError>&)),
-            this,     SLOT(      slotSslErrors(const QList<QSslError>&)));
-    connect(socket, SIGNAL(    peerVerifyError(const QSslError&)),
-            this,     SLOT(slotPeerVerifyError(const QSslError&)));
-    connect(socket, SIGNAL(    disconnected()),
-            this,     SLOT(slotDisconnected()));
-
-    /**
-     * FIX: this code should load all certificates in the chain
-     * not only the first one.
-     */
-    QList<QSslCertificate> cacerts;
-    QFile cacertf(m_settings->sslCaCrt());
-    if (cacertf.open(QIODevice::ReadOnly)) {
-        cacerts << QSslCertificate(&cacertf);
-        cacertf.close();
-        }
+    QThread *thread = m_handshakeThreads[m_nextHandshakeThread];
+    m_nextHandshakeThread = (m_nextHandshakeThread + 1) % m_handshakeThreads.size();
 
-    /**
-     * Sets the private key, local certificate and 
-     * CA certificates chain to the QSslSocket.
-     */
-    socket->setPrivateKey(m_settings->sslKey());
-    socket->setLocalCertificate(m_settings->sslCrt());
-    socket->setCaCertificates(cacerts);
-    socket->startServerEncryption();
+    HttpSslHandshake *handshake = new HttpSslHandshake(socketDescriptor, peer, m_sslConfiguration, m_settings, QThread::currentThread());
+    connect(handshake, SIGNAL(encrypted(QSslSocket *, const QHostAddress&, bool, qint64)),
+            this,        SLOT(slotHandshakeEncrypted(QSslSocket *, const QHostAddress&, bool, qint64)));
+    connect(handshake, SIGNAL(failed(const QHostAddress&)),
+            this,        SLOT(slotHandshakeFailed(const QHostAddress&)));
+    handshake->moveToThread(thread);
+    m_pendingHandshakes++;
+    QMetaObject::invokeMethod(handshake, "start", Qt::QueuedConnection);
 
 }
 
@@ -100,9 +227,20 @@ void HttpTcpServer::slotDisconnected() {
 }
 
 
+/**
+ * @brief Slot is invoked when the connection was closed or timed out before the handshake completed
+ */
+void HttpTcpServer::slotHandshakeFailed(const QHostAddress& peer) {
+    m_pendingHandshakes--;
+    m_failedHandshakes++;
+    m_httpServer->peerClosed(peer);
+}
+
+
 /**
  * @brief Slot is invoked when the SSL hanshake is complete and connection is established
  *
+ * The socket has been moved to the thread of the server already.
  * Each socket and its peer's certificate is registered in m_peerCert.
  * Then newConnectio() signal is emited.
  *
@@ -110,11 +248,24 @@ void HttpTcpServer::slotDisconnected() {
  * In earlier Qt versions prior to 4.7 the QSslSocket missed the addPendingConnection()
  * method. I'm not sure if the ssl works properly in older Qt versions.
  */
-void HttpTcpServer::slotEncrypted() {
-    QSslSocket *socket = qobject_cast<QSslSocket *>(sender());
+void HttpTcpServer::slotHandshakeEncrypted(QSslSocket *socket, const QHostAddress& peer, bool verified, qint64 msecs) {
+    m_pendingHandshakes--;
+
+    // The peer could disconnect while the socket was passed between threads
+    if (socket->state() != QAbstractSocket::ConnectedState) {
+        m_failedHandshakes++;
+        m_httpServer->peerClosed(peer);
+        socket->deleteLater();
+        return;
+        }
+
+    m_handshakes++;
+    m_handshakeTime += msecs;
 
-    QSslCertificate crt = socket->peerCertificate();
-    m_peerCert[socket] = crt;
+    m_verified[socket] = verified;
+    m_peerCert[socket] = socket->peerCertificate();
+    connect(socket, SIGNAL(    disconnected()),
+            this,     SLOT(slotDisconnected()));
 
     #if QT_VERSION > 0x040700
     addPendingConnection(socket);
@@ -123,6 +274,17 @@ void HttpTcpServer::slotEncrypted() {
 }
 
 
+QVariantMap HttpTcpServer::handshakeStatus() const {
+    QVariantMap data;
+    data["handshakes"]          = m_handshakes;
+    data["failedHandshakes"]    = m_failedHandshakes;
+    data["handshakeTime"]       = (m_handshakes > 0) ? (double)m_handshakeTime / m_handshakes : 0.0;
+    data["pendingHandshakes"]   = m_pendingHandshakes;
+    data["handshakeThreads"]    = m_handshakeThreads.size();
+    return data;
+}
+
+
 /**
  * @brief Returns true if the peer's certificate is valid and signed with server's CA certificate 
  */
@@ -141,32 +303,3 @@ QSslCertificate HttpTcpServer::peerCertificate(QTcpSocket *socket) const {
 }
 
 
-/**
- * @brief Slot is called when the peer's certificate is not verified
- */
-void HttpTcpServer::slotPeerVerifyError(const QSslError& error) {
-    Q_UNUSED(error);
-    QSslSocket *socket = qobject_cast<QSslSocket *>(sender());
-    m_verified[socket] = false;
-}
-
-
-/**
- * @brief Slot is called when an SSL error occured
- */
-void HttpTcpServer::slotSslErrors(const QList<QSslError>& errors) {
-    QList<QSslError> ignoreList;
-    for (int i=0; i<errors.size(); i++) {
-        if (m_settings->ignoreSslError(errors[i])) {
-            ignoreList << errors[i];
-            continue;
-            }
-        qDebug() << "sslError" << errors[i].errorString();
-        }
-
-    QSslSocket *socket = qobject_cast<QSslSocket *>(sender());
-    socket->ignoreSslErrors(ignoreList);
-
-}
-
-
@@ -11,6 +11,13 @@
 #include <QHash>
 #include <QSslError>
 #include <QSslCertificate>
+#include <QSslConfiguration>
+#include <QFileSystemWatcher>
+#include <QVariantMap>
+
+class QSslSocket;
+class QThread;
+class QHostAddress;
 
 namespace HobrasoftHttpd {
 
@@ -28,29 +35,83 @@ class HttpSettings;
  *
  * Class stores information of each connection - 
  * its verification status and peer's certificate.
+ *
+ * SSL configuration (key, certificate chain and CA certificates) is read once when
+ * the server is created and it is shared by all connections. The files are watched
+ * and the configuration is reloaded when any of them changes.
+ *
+ * SSL handshakes do not run in the thread of the server. Accepted socket descriptors
+ * are distributed to a pool of handshake threads (one thread per CPU core), each handshake
+ * is performed by HttpSslHandshake. Encrypted sockets are moved back to the thread
+ * of the server and reported with signal newConnection().
+ *
+ * Pending handshakes are counted as open connections of their peers
+ * (HttpServer::reserveConnection()), connections over the limits are closed
+ * before the handshake starts.
  */
 class HttpTcpServer : public QTcpServer {
     Q_OBJECT
   public:
+   ~HttpTcpServer();
     HttpTcpServer(HttpServer *);
 
     bool verified(QTcpSocket *) const;
 
     QSslCertificate peerCertificate(QTcpSocket *) const;
 
+    /**
+     * @brief Returns SSL configuration used for new connections
+     */
+    const QSslConfiguration& sslConfiguration() const { return m_sslConfiguration; }
+
+    /**
+     * @brief Returns counters of TLS handshakes
+     *
+     * - handshakes - number of completed handshakes
+     * - failedHandshakes - connections closed before the handshake completed
+     * - handshakeTime - average duration of completed handshakes in milliseconds
+     * - pendingHandshakes - handshakes in progress
+     * - handshakeThreads - number of threads performing the handshakes
+     */
+    QVariantMap handshakeStatus() const;
+
+  public slots:
+    /**
+     * @brief Reads the key and certificates again, used for new connections
+     *
+     * Called automatically when the files change. Current configuration is kept
+     * when the new files cannot be read.
+     */
+    void    reloadSslConfiguration();
+
   signals:
 
   private slots:
-    void    slotEncrypted();
-    void    slotSslErrors(const QList<QSslError>&);
-    void    slotPeerVerifyError(const QSslError&);
+    void    slotHandshakeEncrypted(QSslSocket *, const QHostAddress&, bool, qint64);
+    void    slotHandshakeFailed(const QHostAddress&);
     void    slotDisconnected();
+    void    slotSslFileChanged(const QString&);
 
   private:
     void    incomingConnection(QINTPTR socketDescriptor);
 
+    HttpServer           *m_httpServer;
     const HttpSettings   *m_settings;
 
+    QSslConfiguration     m_sslConfiguration;
+    QFileSystemWatcher   *m_sslWatcher;
+
+    /**
+     * @brief Threads performing SSL handshakes, used round robin
+     */
+    QList<QThread *>      m_handshakeThreads;
+    int                   m_nextHandshakeThread;
+
+    int                   m_pendingHandshakes;
+    qint64                m_handshakes;
+    qint64                m_failedHandshakes;
+    qint64                m_handshakeTime;
+
     /**
      * @brief Verified status of each socket
      */
@@ -0,0 +1,179 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "httptimerwheel.h"
+#include <QTimer>
+#include <QThreadStorage>
+
+using namespace HobrasoftHttpd;
+
+/**
+ * @brief Duration of one tick of the wheel in milliseconds
+ */
+#define HTTP_TIMER_WHEEL_TICK 250
+
+/**
+ * @brief Number of slots of the wheel, one revolution takes 256 seconds
+ */
+#define HTTP_TIMER_WHEEL_SLOTS 1024
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+namespace {
+QThreadStorage<HttpTimerWheel *> wheels;
+}
+#endif
+
+
+HttpTimer::~HttpTimer() {
+    stop();
+}
+
+
+HttpTimer::HttpTimer(QObject *receiver, const char *member) {
+    m_receiver = receiver;
+    m_member = member;
+    m_wheel = NULL;
+    m_prev = NULL;
+    m_next = NULL;
+    m_deadline = 0;
+}
+
+
+void HttpTimer::start(int msecs) {
+    stop();
+    HttpTimerWheel::instance()->add(this, msecs);
+}
+
+
+void HttpTimer::stop() {
+    if (m_wheel == NULL) { return; }
+    m_wheel->remove(this);
+}
+
+
+HttpTimerWheel::~HttpTimerWheel() {
+    // Timers can outlive the thread, they are only detached
+    for (int i=0; i<m_slots.size(); i++) {
+        HttpTimer *timer = m_slots[i];
+        while (timer != NULL) {
+            HttpTimer *next = timer->m_next;
+            timer->m_wheel = NULL;
+            timer->m_prev = NULL;
+            timer->m_next = NULL;
+            timer = next;
+            }
+        }
+}
+
+
+HttpTimerWheel::HttpTimerWheel() : QObject() {
+    m_slots.fill(NULL, HTTP_TIMER_WHEEL_SLOTS);
+    m_count = 0;
+    m_clock.start();
+    m_tick = currentTick();
+    m_timer = new QTimer(this);
+    m_timer->setInterval(HTTP_TIMER_WHEEL_TICK);
+    connect(m_timer, SIGNAL(timeout()),
+            this,      SLOT(slotTick()));
+}
+
+
+HttpTimerWheel *HttpTimerWheel::instance() {
+    if (!wheels.hasLocalData()) {
+        wheels.setLocalData(new HttpTimerWheel());
+        }
+    return wheels.localData();
+}
+
+
+qint64 HttpTimerWheel::currentTick() const {
+    return m_clock.elapsed() / HTTP_TIMER_WHEEL_TICK;
+}
+
+
+/**
+ * @brief Inserts the timer to the slot of its deadline, the deadline is rounded up to whole ticks
+ */
+void HttpTimerWheel::add(HttpTimer *timer, int msecs) {
+    if (m_count == 0) {
+        // The wheel was stopped, slots between the last tick and now are empty
+        m_tick = currentTick();
+        m_timer->start();
+        }
+
+    qint64 deadline = (m_clock.elapsed() + qMax(msecs, 0) + HTTP_TIMER_WHEEL_TICK - 1) / HTTP_TIMER_WHEEL_TICK;
+    if (deadline <= m_tick) {
+        deadline = m_tick + 1;
+        }
+
+    int slot = deadline % HTTP_TIMER_WHEEL_SLOTS;
+    timer->m_deadline = deadline;
+    timer->m_wheel = this;
+    timer->m_prev = NULL;
+    timer->m_next = m_slots[slot];
+    if (m_slots[slot] != NULL) {
+        m_slots[slot]->m_prev = timer;
+        }
+    m_slots[slot] = timer;
+    m_count++;
+}
+
+
+void HttpTimerWheel::remove(HttpTimer *timer) {
+    if (timer->m_prev != NULL) {
+        timer->m_prev->m_next = timer->m_next;
+      } else {
+        m_slots[timer->m_deadline % HTTP_TIMER_WHEEL_SLOTS] = timer->m_next;
+        }
+    if (timer->m_next != NULL) {
+        timer->m_next->m_prev = timer->m_prev;
+        }
+    timer->m_wheel = NULL;
+    timer->m_prev = NULL;
+    timer->m_next = NULL;
+
+    m_count--;
+    if (m_count == 0) {
+        m_timer->stop();
+        }
+}
+
+
+/**
+ * @brief Advances the wheel to the current tick, expired timers are invoked
+ */
+void HttpTimerWheel::slotTick() {
+    qint64 now = currentTick();
+
+    // After a long stall every slot is visited once
+    qint64 from = qMax(m_tick + 1, now - HTTP_TIMER_WHEEL_SLOTS + 1);
+    for (qint64 tick = from; tick <= now && m_count > 0; tick++) {
+        m_tick = tick;
+        expire(tick % HTTP_TIMER_WHEEL_SLOTS, now);
+        }
+    m_tick = now;
+}
+
+
+/**
+ * @brief Invokes expired timers of one slot
+ *
+ * The receiver can start or stop any timer, even delete other timers of the slot.
+ * The scan starts from the head of the slot again after each invocation.
+ */
+void HttpTimerWheel::expire(int slot, qint64 now) {
+    HttpTimer *timer = m_slots[slot];
+    while (timer != NULL) {
+        if (timer->m_deadline > now) {
+            timer = timer->m_next;
+            continue;
+            }
+        remove(timer);
+        QMetaObject::invokeMethod(timer->m_receiver, timer->m_member.constData(), Qt::DirectConnection);
+        timer = m_slots[slot];
+        }
+}
+
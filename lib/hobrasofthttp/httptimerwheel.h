@@ -0,0 +1,124 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#ifndef _HttpTimerWheel_H_
+#define _HttpTimerWheel_H_
+
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QElapsedTimer>
+
+class QTimer;
+
+namespace HobrasoftHttpd {
+
+class HttpTimerWheel;
+
+/**
+ * @brief Single shot timer driven by the timer wheel of the current thread
+ *
+ * Lightweight replacement of QTimer for timeouts which are restarted very often
+ * and which expire seldom (idle connections, slow reading or writing).
+ * Starting and stopping the timer is O(1), no object is registered in the event dispatcher.
+ *
+ * The resolution of the timer is one tick of the wheel (HTTP_TIMER_WHEEL_TICK milliseconds),
+ * the timer never expires sooner than requested.
+ *
+ * The timer must be started and stopped in one thread. When the owner moves to another
+ * thread, the timer has to be stopped before and started again in the new thread.
+ */
+class HttpTimer {
+  public:
+   ~HttpTimer();
+
+    /**
+     * @brief Constructor
+     *
+     * @param receiver - object to be notified
+     * @param member - name of the slot invoked when the timer expires, without SLOT() macro
+     */
+    HttpTimer(QObject *receiver, const char *member);
+
+    /**
+     * @brief Starts or restarts the timer
+     */
+    void    start(int msecs);
+
+    /**
+     * @brief Stops the timer
+     */
+    void    stop();
+
+    /**
+     * @brief Returns true if the timer is running
+     */
+    bool    isActive() const { return m_wheel != NULL; }
+
+  private:
+    #ifndef DOXYGEN_SHOULD_SKIP_THIS
+    friend class HttpTimerWheel;
+    HttpTimer(const HttpTimer&);
+    HttpTimer& operator=(const HttpTimer&);
+
+    QObject            *m_receiver;
+    QByteArray          m_member;
+    HttpTimerWheel     *m_wheel;
+    HttpTimer          *m_prev;
+    HttpTimer          *m_next;
+    qint64              m_deadline;
+    #endif
+};
+
+
+/**
+ * @brief Hashed timing wheel, one instance per thread
+ *
+ * Timers are hashed to slots by the tick of their deadline, each slot is a doubly
+ * linked list of timers. One QTimer per thread advances the wheel, the QTimer runs
+ * only when any HttpTimer of the thread is active.
+ *
+ * Timers with deadline further than one revolution of the wheel stay in their slot
+ * until their deadline really comes.
+ */
+class HttpTimerWheel : public QObject {
+    Q_OBJECT
+  public:
+   ~HttpTimerWheel();
+
+    /**
+     * @brief Returns the timer wheel of the current thread, the wheel is created on first use
+     */
+    static HttpTimerWheel *instance();
+
+    /**
+     * @brief Returns number of active timers of the wheel
+     */
+    int     count() const { return m_count; }
+
+  private slots:
+    #ifndef DOXYGEN_SHOULD_SKIP_THIS
+    void    slotTick();
+
+  private:
+    friend class HttpTimer;
+    HttpTimerWheel();
+    qint64  currentTick() const;
+    void    add(HttpTimer *timer, int msecs);
+    void    remove(HttpTimer *timer);
+    void    expire(int slot, qint64 now);
+
+    QTimer                 *m_timer;
+    QElapsedTimer           m_clock;
+    qint64                  m_tick;
+    QVector<HttpTimer *>    m_slots;
+    int                     m_count;
+    #endif
+};
+
+}
+
+#endif
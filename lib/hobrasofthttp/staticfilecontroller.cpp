@@ -10,6 +10,8 @@
 #include "httpsettings.h"
 #include "httpresponse.h"
 #include "httprequest.h"
+#include "httpcontentcache.h"
+#include "httpcontentencoding.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
@@ -18,10 +20,22 @@
 #include <QDateTime>
 #include <QDebug>
 #include <QRegExp>
+#include <QLocale>
+#include <QUuid>
+#include <QPair>
+#include <algorithm>
+#include <QMutexLocker>
 
 using namespace HobrasoftHttpd;
 
+/**
+ * @brief Maximum number of ranges after merging, Range header with more ranges is ignored
+ */
+#define MAX_RANGES 16
+
 QHash<QString, QString> StaticFileController::m_mimetypes;
+QHash<QString, QByteArray> StaticFileController::m_entityTags;
+QMutex StaticFileController::m_entityTagsMutex;
 
 StaticFileController::StaticFileController(HttpConnection *parent) : HttpRequestHandler(parent) {
 
@@ -69,21 +83,33 @@ void StaticFileController::service(HttpRequest *request, HttpResponse *response)
     QFileInfo fileinfo(filename);
     if (fileinfo.isDir()) {
         filename += "/" + settings()->indexFile();
+        fileinfo.setFile(filename);
         }
 
-    QFile file(QDir::toNativeSeparators(filename));
-    if (!file.exists()) {
+    if (!fileinfo.exists()) {
         response->setStatus(404, "Not found");
         response->write("404 Not found");
         response->flush();
         return;
         }
 
-    if (!file.open(QIODevice::ReadOnly)) {
-        response->setStatus(403, "Forbidden");
-        response->write("403 Forbidden");
-        response->flush();
-        return;
+    // Precompressed sidecar files written next to the file (app.js.gz, app.js.br) are preferred
+    QByteArray encoding;
+    QString acceptEncoding = request->header(HttpRequest::HeaderAcceptEncoding);
+    if (fileinfo.isFile() && !acceptEncoding.isEmpty()) {
+        QList<QByteArray> available;
+        QList<const HttpContentEncoder *> encoders = HttpContentEncoding::encoders();
+        for (int i=0; i<encoders.size(); i++) {
+            QFileInfo sidecarinfo(filename + encoders[i]->suffix());
+            if (sidecarinfo.isFile() && sidecarinfo.lastModified() >= fileinfo.lastModified()) {
+                available << encoders[i]->name();
+                }
+            }
+
+        if (!available.isEmpty()) {
+            encoding = HttpContentEncoding::negotiate(acceptEncoding, available);
+            response->setHeader("Vary", "Accept-Encoding");
+            }
         }
 
     QString suffix = fileinfo.suffix();
@@ -91,10 +117,293 @@ void StaticFileController::service(HttpRequest *request, HttpResponse *response)
         response->setHeader("Content-Type", m_mimetypes[suffix]);
         }
 
-    response->setHeader("Cache-Control", QString("Public,max-age=") + QString("%1").arg(settings()->maxAge()) );
-    response->setHeader("Expires", toGMTString(QDateTime::currentDateTime().addSecs(settings()->maxAge()).toUTC()) );
-    response->write( file.readAll() );
+    QDateTime lastModified = fileinfo.lastModified().toUTC();
+    QByteArray etag = entityTag(fileinfo);
+    if (!etag.isEmpty()) {
+        response->setHeader("ETag", QString::fromLatin1(HttpContentEncoding::entityTag(etag, encoding)));
+        }
+    response->setHeader("Last-Modified", toGMTString(lastModified));
+    // Fingerprinted files (app.3f2a9c1b.js) never change, new version gets new name
+    const QRegularExpression& immutablePattern = settings()->immutablePattern();
+    bool immutable = !immutablePattern.pattern().isEmpty() && immutablePattern.match(fileinfo.fileName()).hasMatch();
+    int maxAge = immutable ? settings()->immutableMaxAge() : settings()->maxAge();
+    response->setHeader("Cache-Control", QString("Public,max-age=") + QString("%1").arg(maxAge) + (immutable ? ",immutable" : ""));
+    response->setHeader("Expires", toGMTString(QDateTime::currentDateTime().addSecs(maxAge).toUTC()) );
+
+    if (notModified(request, etag, lastModified)) {
+        response->setStatus(304, "Not Modified");
+        response->flush();
+        return;
+        }
+
+    if (fileinfo.isFile()) {
+        response->setHeader("Accept-Ranges", "bytes");
+        if (serveRanges(request, response, fileinfo, etag, lastModified)) {
+            return;
+            }
+        }
+
+    QByteArray content;
+    QByteArray digest;
+    const HttpContentEncoder *encoder = HttpContentEncoding::encoder(encoding);
+    if (encoder != NULL && readFile(QFileInfo(filename + encoder->suffix()), &content, &digest)) {
+        response->setHeader("Content-Encoding", QString::fromLatin1(encoding));
+      } else {
+        if (!etag.isEmpty()) {
+            response->setHeader("ETag", QString::fromLatin1(etag));
+            }
+        if (!readFile(fileinfo, &content, &digest)) {
+            response->headers().remove("ETag");
+            response->headers().remove("Last-Modified");
+            response->setStatus(403, "Forbidden");
+            response->write("403 Forbidden");
+            response->flush();
+            return;
+            }
+        }
+
+    response->setContentDigest(digest);
+    response->write(content);
+    response->flush();
+}
+
+
+QList<QPair<qint64, qint64> > StaticFileController::parseRanges(const QString& range, qint64 size, bool *valid) {
+    QList<QPair<qint64, qint64> > ranges;
+    *valid = false;
+    if (!range.startsWith("bytes=", Qt::CaseInsensitive)) {
+        return ranges;
+        }
+
+    QStringList specs = range.mid(6).split(',');
+    for (int i=0; i<specs.size(); i++) {
+        QString spec = specs[i].trimmed();
+        int dash = spec.indexOf('-');
+        if (dash < 0) {
+            return QList<QPair<qint64, qint64> >();
+            }
+        bool ok1 = true;
+        bool ok2 = true;
+        qint64 first = (dash > 0) ? spec.left(dash).toLongLong(&ok1) : -1;
+        qint64 last  = (dash < spec.size()-1) ? spec.mid(dash+1).toLongLong(&ok2) : -1;
+        if (!ok1 || !ok2 || (first < 0 && last < 0) || (first >= 0 && last >= 0 && last < first)) {
+            return QList<QPair<qint64, qint64> >();
+            }
+
+        if (first < 0) {            // suffix range, last bytes of the file
+            if (last == 0) { continue; }
+            first = qMax(Q_INT64_C(0), size - last);
+            last  = size - 1;
+          } else if (last < 0 || last >= size) {
+            last  = size - 1;
+            }
+
+        if (first >= size) {        // unsatisfiable
+            continue;
+            }
+        ranges << qMakePair(first, last);
+        }
+
+    *valid = true;
+    if (ranges.isEmpty()) {
+        return ranges;
+        }
+
+    // Overlapping ranges are merged, the same bytes are never sent twice
+    std::sort(ranges.begin(), ranges.end());
+    QList<QPair<qint64, qint64> > coalesced;
+    coalesced << ranges.first();
+    for (int i=1; i<ranges.size(); i++) {
+        if (ranges[i].first <= coalesced.last().second + 1) {
+            coalesced.last().second = qMax(coalesced.last().second, ranges[i].second);
+            continue;
+            }
+        coalesced << ranges[i];
+        }
+
+    if (coalesced.size() > MAX_RANGES) {
+        *valid = false;
+        return QList<QPair<qint64, qint64> >();
+        }
+    return coalesced;
+}
+
+
+/**
+ * @brief Sends parts of the file requested in Range header (206 Partial Content)
+ *
+ * Only the identity representation is sent in parts. Overlapping ranges are
+ * coalesced, more than 16 ranges or malformed header are ignored and the whole file is sent.
+ * Parts are not read at once, they are read in blocks while the socket writes them,
+ * see HttpResponse::writeFile().
+ *
+ * @returns false if the Range header should be ignored and the whole file should be sent
+ */
+bool StaticFileController::serveRanges(HttpRequest *request, HttpResponse *response, const QFileInfo& fileinfo, const QByteArray& etag, const QDateTime& lastModified) const {
+    QString range = request->header(HttpRequest::HeaderRange).trimmed();
+    if (range.isEmpty() || request->method() != "GET") {
+        return false;
+        }
+
+    // If-Range: send parts only if the client has current version of the file
+    QString ifRange = request->header(HttpRequest::HeaderIfRange).trimmed();
+    if (!ifRange.isEmpty()) {
+        if (ifRange.startsWith('"') || ifRange.startsWith("W/")) {
+            if (etag.isEmpty() || ifRange.toLatin1() != etag) {
+                return false;
+                }
+          } else {
+            QDateTime date = fromGMTString(ifRange);
+            if (!date.isValid() || date.toMSecsSinceEpoch() / 1000 != lastModified.toMSecsSinceEpoch() / 1000) {
+                return false;
+                }
+            }
+        }
+
+    qint64 size = fileinfo.size();
+    bool valid = false;
+    QList<QPair<qint64, qint64> > ranges = parseRanges(range, size, &valid);
+    if (!valid) {
+        return false;
+        }
+
+    if (ranges.isEmpty()) {
+        response->headers().remove("ETag");
+        response->headers().remove("Vary");
+        response->setStatus(416, "Range Not Satisfiable");
+        response->setHeader("Content-Range", QString("bytes */%1").arg(size));
+        response->flush();
+        return true;
+        }
+
+    QString path = QDir::toNativeSeparators(fileinfo.filePath());
+    if (!fileinfo.isReadable()) {
+        return false;
+        }
+
+    if (!etag.isEmpty()) {
+        response->setHeader("ETag", QString::fromLatin1(etag));
+        }
+
+    response->setStatus(206, "Partial Content");
+    if (ranges.size() == 1) {
+        qint64 first = ranges[0].first;
+        qint64 last  = ranges[0].second;
+        response->setHeader("Content-Range", QString("bytes %1-%2/%3").arg(first).arg(last).arg(size));
+        response->writeFile(path, first, last - first + 1);
+        response->flush();
+        return true;
+        }
+
+    QByteArray boundary = QUuid::createUuid().toRfc4122().toHex();
+    QByteArray contentType = response->headers().value("Content-Type").toUtf8();
+    for (int i=0; i<ranges.size(); i++) {
+        qint64 first = ranges[i].first;
+        qint64 last  = ranges[i].second;
+        QByteArray head = (i > 0) ? "\r\n" : "";
+        head += "--" + boundary + "\r\n";
+        if (!contentType.isEmpty()) {
+            head += "Content-Type: " + contentType + "\r\n";
+            }
+        head += QString("Content-Range: bytes %1-%2/%3\r\n\r\n").arg(first).arg(last).arg(size).toUtf8();
+        response->write(head);
+        response->writeFile(path, first, last - first + 1);
+        }
+    response->write("\r\n--" + boundary + "--\r\n");
+
+    response->setHeader("Content-Type", "multipart/byteranges; boundary=" + QString::fromLatin1(boundary));
     response->flush();
+    return true;
+}
+
+
+/**
+ * @brief Returns true if the client has current version of the file (If-None-Match, If-Modified-Since)
+ *
+ * If-Modified-Since is used only when the request contains no If-None-Match header.
+ */
+bool StaticFileController::notModified(HttpRequest *request, const QByteArray& etag, const QDateTime& lastModified) const {
+    QString ifNoneMatch = request->header(HttpRequest::HeaderIfNoneMatch);
+    if (!ifNoneMatch.isEmpty()) {
+        if (etag.isEmpty()) {
+            return false;
+            }
+        QStringList tags = ifNoneMatch.split(',');
+        for (int i=0; i<tags.size(); i++) {
+            QByteArray tag = tags[i].trimmed().toLatin1();
+            if (tag == "*") {
+                return true;
+                }
+            if (tag.startsWith("W/")) {
+                tag = tag.mid(2);
+                }
+            if (HttpContentEncoding::identityEntityTag(tag) == etag) {
+                return true;
+                }
+            }
+        return false;
+        }
+
+    QString ifModifiedSince = request->header(HttpRequest::HeaderIfModifiedSince);
+    if (ifModifiedSince.isEmpty()) {
+        return false;
+        }
+
+    QDateTime since = fromGMTString(ifModifiedSince);
+    if (!since.isValid()) {
+        return false;
+        }
+    return lastModified.toMSecsSinceEpoch() / 1000 <= since.toMSecsSinceEpoch() / 1000;
+}
+
+
+/**
+ * @brief Returns strong entity tag of the file registered with addEntityTag() or empty QByteArray
+ */
+QByteArray StaticFileController::entityTag(const QFileInfo& fileinfo) {
+    QMutexLocker locker(&m_entityTagsMutex);
+    QString key = QDir::cleanPath(fileinfo.absoluteFilePath());
+    if (!m_entityTags.contains(key)) {
+        return QByteArray();
+        }
+    return '"' + m_entityTags.value(key) + '"';
+}
+
+
+void StaticFileController::addEntityTag(const QString& filename, const QByteArray& tag) {
+    QMutexLocker locker(&m_entityTagsMutex);
+    m_entityTags[QDir::cleanPath(QFileInfo(filename).absoluteFilePath())] = tag;
+}
+
+
+void StaticFileController::clearEntityTags() {
+    QMutexLocker locker(&m_entityTagsMutex);
+    m_entityTags.clear();
+}
+
+
+/**
+ * @brief Reads the file from HttpContentCache or from disk
+ *
+ * Files which are not too large are stored to the cache.
+ * Digest is empty if the file is not cached.
+ */
+bool StaticFileController::readFile(const QFileInfo& fileinfo, QByteArray *content, QByteArray *digest) const {
+    if (HttpContentCache::file(fileinfo, content, digest)) {
+        return true;
+        }
+
+    QFile file(QDir::toNativeSeparators(fileinfo.filePath()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+        }
+
+    *content = file.readAll();
+    digest->clear();
+    if (content->size() <= settings()->maxCachedFileSize()) {
+        *digest = HttpContentCache::insertFile(fileinfo, *content);
+        }
+    return true;
 }
 
 
@@ -128,14 +437,21 @@ QString StaticFileController::toGMTString(const QDateTime& x) {
 
     QString string = QString("%1, %2 %3 %4 %5:%6:%7 GMT")
                         .arg(dayname)
-                        .arg(x.date().day())
+                        .arg(x.date().day(), 2, 10, QChar('0'))
                         .arg(monthname)
                         .arg(x.date().year())
-                        .arg(x.time().hour())
-                        .arg(x.time().minute())
-                        .arg(x.time().second())
+                        .arg(x.time().hour(), 2, 10, QChar('0'))
+                        .arg(x.time().minute(), 2, 10, QChar('0'))
+                        .arg(x.time().second(), 2, 10, QChar('0'))
                         ;
     return string;
 }
 
 
+QDateTime StaticFileController::fromGMTString(const QString& x) {
+    QDateTime datetime = QLocale::c().toDateTime(x.trimmed(), "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+    datetime.setTimeSpec(Qt::UTC);
+    return datetime;
+}
+
+
@@ -12,6 +12,10 @@
 #include <QCache>
 #include <QHash>
 #include <QDateTime>
+#include <QFileInfo>
+#include <QMutex>
+#include <QList>
+#include <QPair>
 #include "httprequesthandler.h"
 #include "testsettings.h"
 
@@ -56,6 +60,42 @@ class StaticFileController : public HttpRequestHandler {
 
     static QString toGMTString(const QDateTime&);
 
+    /**
+     * @brief Parses date in HTTP format (Sun, 06 Nov 1994 08:49:37 GMT), returns invalid QDateTime on error
+     */
+    static QDateTime fromGMTString(const QString&);
+
+    /**
+     * @brief Registers strong entity tag (ETag) of the file (common for all class instances)
+     *
+     * Tag is usually a digest of the file content known in advance, it is sent
+     * without any computation in ETag header and compared with If-None-Match header.
+     * Files without registered tag are validated by the modification time only.
+     *
+     * @param filename - path of the file in the document root
+     * @param tag - tag without quotes, for example hex encoded MD5 digest
+     */
+    static void addEntityTag(const QString& filename, const QByteArray& tag);
+
+    /**
+     * @brief Removes all registered entity tags
+     */
+    static void clearEntityTags();
+
+    /**
+     * @brief Parses Range header of the file of given size
+     *
+     * Ranges are sorted, overlapping and adjacent ranges are merged. Unsatisfiable ranges are left out,
+     * the empty list is returned when no range can be satisfied (416 response).
+     *
+     * @param range - value of the Range header (bytes=0-99,200-)
+     * @param size - size of the file
+     * @param valid - set to false when the header is malformed or has too many ranges,
+     *                the header should be ignored then and the whole file sent
+     * @returns list of first and last bytes of the ranges
+     */
+    static QList<QPair<qint64, qint64> > parseRanges(const QString& range, qint64 size, bool *valid);
+
 
   private:
     /**
@@ -63,8 +103,30 @@ class StaticFileController : public HttpRequestHandler {
      */
     const HttpSettings *settings() const;
 
+    /**
+     * @brief Reads the file using the content cache
+     */
+    bool readFile(const QFileInfo& fileinfo, QByteArray *content, QByteArray *digest) const;
+
+    /**
+     * @brief Sends parts of the file requested in Range header
+     */
+    bool serveRanges(HttpRequest *request, HttpResponse *response, const QFileInfo& fileinfo, const QByteArray& etag, const QDateTime& lastModified) const;
+
+    /**
+     * @brief Evaluates conditional headers of the request
+     */
+    bool notModified(HttpRequest *request, const QByteArray& etag, const QDateTime& lastModified) const;
+
+    /**
+     * @brief Returns quoted entity tag of the file or empty QByteArray
+     */
+    static QByteArray entityTag(const QFileInfo& fileinfo);
+
     #ifndef DOXYGEN_SHOULD_SKIP_THIS
     static QHash<QString, QString> m_mimetypes;
+    static QHash<QString, QByteArray> m_entityTags;
+    static QMutex m_entityTagsMutex;
     HttpConnection  *m_parent;
     #endif
 
@@ -3,6 +3,7 @@
 
 #include "lib/hobrasofthttp/httpserver.h"
 #include "lib/hobrasofthttp/httpsettings.h"
+#include "lib/hobrasofthttp/staticfilecontroller.h"
 
 #include <QDebug>
 #include <QtCore>
@@ -71,6 +72,16 @@ Backend::launchServer()
   mExposedServerAddress = QStringLiteral("http://localhost:%1").arg(mServerPort);
   emit exposedServerAddressChanged();
 
+  // The manifest digests serve as ETags, so revalidation requires no hashing
+  using HobrasoftHttpd::StaticFileController;
+  StaticFileController::clearEntityTags();
+  if (const Dist* dist = mDistUpdater.currentDist()) {
+    const QHash<QString, QByteArray> md5s = dist->entryMd5sByFilePath();
+    for (auto it = md5s.cbegin(); it != md5s.cend(); ++it) {
+      StaticFileController::addEntityTag(it.key(), it.value());
+    }
+  }
+
   auto* serverSettings = new HobrasoftHttpd::HttpSettings(this);
   serverSettings->setDocroot(mAppDataDir.absolutePath());
   serverSettings->setPort(mServerPort);
@@ -1,12 +1,21 @@
 #include "dist.h"
 #include "file_md5.h"
 
+#include "lib/hobrasofthttp/httpcontentencoding.h"
+
 #include <QDebug>
 
 namespace Lisons {
 
 static const char* const COLUMN_SEPARATOR = " ";
 
+static bool
+isCompressible(const QString& fileName)
+{
+  static const QStringList compressibleSuffixes{ "html", "htm", "css", "js", "json", "txt" };
+  return compressibleSuffixes.contains(QFileInfo(fileName).suffix(), Qt::CaseInsensitive);
+}
+
 Dist::Dist(QDir& dir, const QString suffix, const QByteArray md5)
   : mDir(dir)
   , mSuffix(suffix)
@@ -89,6 +98,33 @@ Dist::remove()
   }
 }
 
+// Absolute paths of the entries that are worth sending compressed
+QStringList
+Dist::compressibleFilePaths() const
+{
+  QStringList filePaths;
+  for (const QString& entryFileName : entryFileNames()) {
+    if (isCompressible(entryFileName)) {
+      filePaths.append(mDir.absoluteFilePath(entryFileName) + mSuffix);
+    }
+  }
+  return filePaths;
+}
+
+// Writes a compressed copy next to every file for every content coding the server supports
+// (app.js.gz, app.js.br, ...) so that the server can send it as is instead of compressing
+// the file on every request. Compression at the best levels is slow, so this is meant to be
+// run off the GUI thread
+void
+Dist::writeCompressedSidecars(const QStringList& filePaths)
+{
+  for (const QString& filePath : filePaths) {
+    if (!HobrasoftHttpd::HttpContentEncoding::writePrecompressed(filePath)) {
+      qWarning() << "Could not write all compressed copies of" << filePath;
+    }
+  }
+}
+
 QVector<QString>
 Dist::entryFileNames() const
 {
@@ -99,6 +135,20 @@ Dist::entryFileNames() const
   return fileNames;
 }
 
+// Maps absolute paths of the entries to their hex MD5 digests listed in the manifest
+QHash<QString, QByteArray>
+Dist::entryMd5sByFilePath() const
+{
+  QHash<QString, QByteArray> md5s;
+  for (const FileEntry& entry : mEntries) {
+    if (entry.md5.isEmpty()) {
+      continue;
+    }
+    md5s.insert(mDir.absoluteFilePath(entry.fileName) + mSuffix, entry.md5.toLatin1());
+  }
+  return md5s;
+}
+
 const QString&
 Dist::suffix() const
 {
@@ -14,7 +14,10 @@ public:
   bool isValid();
   bool changeSuffix(const QString& newSuffix);
   void remove();
+  QStringList compressibleFilePaths() const;
+  static void writeCompressedSidecars(const QStringList& filePaths);
   QVector<QString> entryFileNames() const;
+  QHash<QString, QByteArray> entryMd5sByFilePath() const;
   const QString& suffix() const;
   QByteArray md5() const;
 
@@ -16,6 +16,7 @@ DistUpdater::DistUpdater(QObject* parent, const QDir& saveDir)
   QString distManifestPath = mDistDir.absoluteFilePath(QLatin1String(MANIFEST_FILE_NAME));
   QFile distManifestFile{ distManifestPath };
   mCurrDist = Dist::fromManifestFile(distManifestFile, mDistDir, QString());
+  connect(&mCompression, &QFutureWatcher<void>::finished, this, &DistUpdater::compressionFinished);
 }
 
 void
@@ -29,6 +30,12 @@ DistUpdater::updateAndVerify()
   emit stateChanged(DistUpdaterState::DownloadingDistManifest);
 }
 
+const Dist*
+DistUpdater::currentDist() const
+{
+  return mCurrDist.get();
+}
+
 void
 DistUpdater::enqueueDownload(const QString& fileName)
 {
@@ -112,8 +119,8 @@ DistUpdater::downloadFinished()
 
     if (mCurrDist && *mCurrDist == *mNewDist && mCurrDist->isValid()) {
       // We already have the latest version
-      emit stateChanged(DistUpdaterState::UpToDateAndDistValid);
       mOutputFile.remove();
+      finishWithCompressedSidecars(*mCurrDist);
       return;
     }
 
@@ -136,13 +143,28 @@ DistUpdater::downloadFinished()
       && cleanDistDirPreserving(*mNewDist)
       && mNewDist->changeSuffix(mCurrDist->suffix())) {
     // We've successfully committed the downloaded version
-    emit stateChanged(DistUpdaterState::UpToDateAndDistValid);
+    mCurrDist = std::move(mNewDist);
+    finishWithCompressedSidecars(*mCurrDist);
     return;
   }
 
   fallBackToCurrDist();
 }
 
+// Compresses the files of the Dist in a worker thread and reports the Dist as ready once
+// the compressed copies are in place
+void
+DistUpdater::finishWithCompressedSidecars(const Dist& dist)
+{
+  mCompression.setFuture(QtConcurrent::run(&Dist::writeCompressedSidecars, dist.compressibleFilePaths()));
+}
+
+void
+DistUpdater::compressionFinished()
+{
+  emit stateChanged(DistUpdaterState::UpToDateAndDistValid);
+}
+
 void
 DistUpdater::downloadReadyRead()
 {
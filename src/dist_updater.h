@@ -3,6 +3,7 @@
 
 #include "dist.h"
 
+#include <QtConcurrent>
 #include <QtCore>
 #include <QtNetwork>
 
@@ -23,6 +24,7 @@ class DistUpdater : public QObject
 public:
   DistUpdater(QObject* parent, const QDir& saveDir);
   void updateAndVerify();
+  const Dist* currentDist() const;
 
 signals:
   void stateChanged(DistUpdaterState newState);
@@ -31,11 +33,13 @@ private:
   void enqueueDownload(const QString& fileName);
   void fallBackToCurrDist();
   bool cleanDistDirPreserving(const Dist& distToPreserve);
+  void finishWithCompressedSidecars(const Dist& dist);
 
 private slots:
   void startNextDownload();
   void downloadReadyRead();
   void downloadFinished();
+  void compressionFinished();
 
 private:
   QDir mDistDir;
@@ -45,6 +49,7 @@ private:
   QFile mOutputFile;
   std::unique_ptr<Dist> mCurrDist;
   std::unique_ptr<Dist> mNewDist;
+  QFutureWatcher<void> mCompression;
 };
 }
 
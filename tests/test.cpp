@@ -0,0 +1,10 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "test.h"
+#include <QtTest>
+
+QTEST_GUILESS_MAIN(Test)
@@ -0,0 +1,49 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+#ifndef _Test_H_
+#define _Test_H_
+
+#include <QObject>
+
+/**
+ * @brief Unit tests of the HobrasoftHttpd library
+ *
+ * Library classes declare the Test class as a friend (FRIEND_CLASS_TEST),
+ * tests can use their private members. Tests of each class are in separate
+ * source file, test_gzip.cpp tests HttpGZipCompression for example.
+ */
+class Test : public QObject {
+    Q_OBJECT
+  private slots:
+    void gzipCrc32_data();
+    void gzipCrc32();
+    void gzipCrc32Incremental();
+    void gzipFraming_data();
+    void gzipFraming();
+    void gzipStream();
+
+    void contentEncodingQuality_data();
+    void contentEncodingQuality();
+    void contentEncodingNegotiate_data();
+    void contentEncodingNegotiate();
+    void contentEncodingEntityTag();
+
+    void parseRanges_data();
+    void parseRanges();
+
+    void multiPartParser_data();
+    void multiPartParser();
+    void multiPartParserIncomplete();
+
+    void timerWheelExpiry();
+    void timerWheelZero();
+    void timerWheelStop();
+    void timerWheelRestart();
+    void timerWheelMany();
+    void timerWheelStopFromReceiver();
+};
+
+#endif
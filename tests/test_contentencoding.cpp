@@ -0,0 +1,109 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "test.h"
+#include "httpcontentencoding.h"
+#include <QtTest>
+
+using namespace HobrasoftHttpd;
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+/**
+ * @brief Encoder registered after the built-in encoders, tests the preference of codings
+ */
+class TestEncoder : public HttpContentEncoder {
+  public:
+    QByteArray name() const { return "x-test"; }
+    QString suffix() const { return ".x-test"; }
+    int maxLevel() const { return 0; }
+    QByteArray encode(const QByteArray& data, int) const { return data; }
+};
+
+
+void registerTestEncoder() {
+    static bool registered = false;
+    if (!registered) {
+        HttpContentEncoding::addEncoder(new TestEncoder);
+        registered = true;
+        }
+}
+#endif
+
+}
+
+
+void Test::contentEncodingQuality_data() {
+    QTest::addColumn<QString>("acceptEncoding");
+    QTest::addColumn<QByteArray>("name");
+    QTest::addColumn<double>("quality");
+
+    QTest::newRow("listed")             << "gzip"                       << QByteArray("gzip")       << 1.0;
+    QTest::newRow("q-value")            << "gzip;q=0.5"                 << QByteArray("gzip")       << 0.5;
+    QTest::newRow("case")               << "GZIP;Q=0.5"                 << QByteArray("gzip")       << 0.5;
+    QTest::newRow("spaces")             << " br , gzip ; q=0.3 "        << QByteArray("gzip")       << 0.3;
+    QTest::newRow("not listed")         << "br"                         << QByteArray("gzip")       << 0.0;
+    QTest::newRow("refused")            << "gzip;q=0"                   << QByteArray("gzip")       << 0.0;
+    QTest::newRow("invalid q-value")    << "gzip;q=abc"                 << QByteArray("gzip")       << 0.0;
+    QTest::newRow("star")               << "br;q=0.9, *;q=0.2"          << QByteArray("gzip")       << 0.2;
+    QTest::newRow("listed over star")   << "*;q=0.2, gzip;q=0"          << QByteArray("gzip")       << 0.0;
+    QTest::newRow("identity default")   << "gzip"                       << QByteArray("identity")   << 0.001;
+    QTest::newRow("identity listed")    << "gzip, identity;q=0.5"       << QByteArray("identity")   << 0.5;
+    QTest::newRow("identity refused")   << "gzip, identity;q=0"         << QByteArray("identity")   << 0.0;
+    QTest::newRow("identity star")      << "gzip, *;q=0"                << QByteArray("identity")   << 0.0;
+}
+
+
+void Test::contentEncodingQuality() {
+    QFETCH(QString, acceptEncoding);
+    QFETCH(QByteArray, name);
+    QFETCH(double, quality);
+
+    QCOMPARE(HttpContentEncoding::quality(acceptEncoding, name), quality);
+}
+
+
+void Test::contentEncodingNegotiate_data() {
+    registerTestEncoder();
+
+    QTest::addColumn<QString>("acceptEncoding");
+    QTest::addColumn<QByteArray>("available");
+    QTest::addColumn<QByteArray>("encoding");
+
+    QTest::newRow("no header")          << ""                               << QByteArray("gzip")        << QByteArray();
+    QTest::newRow("gzip")               << "gzip, deflate"                  << QByteArray("gzip")        << QByteArray("gzip");
+    QTest::newRow("refused")            << "gzip;q=0"                       << QByteArray("gzip")        << QByteArray();
+    QTest::newRow("unknown")            << "deflate"                        << QByteArray("gzip")        << QByteArray();
+    QTest::newRow("star")               << "*"                              << QByteArray("gzip")        << QByteArray("gzip");
+    QTest::newRow("identity preferred") << "gzip;q=0.5, identity"           << QByteArray("gzip")        << QByteArray();
+    QTest::newRow("identity same q")    << "gzip;q=0.5, identity;q=0.5"     << QByteArray("gzip")        << QByteArray("gzip");
+    QTest::newRow("identity refused")   << "gzip, identity;q=0"             << QByteArray("gzip")        << QByteArray("gzip");
+    QTest::newRow("not available")      << "x-test"                         << QByteArray("gzip")        << QByteArray();
+    QTest::newRow("higher q")           << "x-test;q=0.8, gzip;q=0.9"       << QByteArray("gzip,x-test") << QByteArray("gzip");
+    QTest::newRow("higher q later")     << "x-test, gzip;q=0.9"             << QByteArray("gzip,x-test") << QByteArray("x-test");
+    QTest::newRow("registration order") << "x-test, gzip"                   << QByteArray("gzip,x-test") << QByteArray("gzip");
+    QTest::newRow("all registered")     << "x-test"                         << QByteArray()              << QByteArray("x-test");
+}
+
+
+void Test::contentEncodingNegotiate() {
+    QFETCH(QString, acceptEncoding);
+    QFETCH(QByteArray, available);
+    QFETCH(QByteArray, encoding);
+
+    QList<QByteArray> list = available.isEmpty() ? QList<QByteArray>() : available.split(',');
+    QCOMPARE(HttpContentEncoding::negotiate(acceptEncoding, list), encoding);
+}
+
+
+void Test::contentEncodingEntityTag() {
+    QCOMPARE(HttpContentEncoding::entityTag("\"abc\"", "gzip"), QByteArray("\"abc-gzip\""));
+    QCOMPARE(HttpContentEncoding::entityTag("\"abc\"", QByteArray()), QByteArray("\"abc\""));
+    QCOMPARE(HttpContentEncoding::identityEntityTag("\"abc-gzip\""), QByteArray("\"abc\""));
+    QCOMPARE(HttpContentEncoding::identityEntityTag("\"abc\""), QByteArray("\"abc\""));
+    QCOMPARE(HttpContentEncoding::identityEntityTag("\"abc-deflate\""), QByteArray("\"abc-deflate\""));
+}
@@ -0,0 +1,188 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "test.h"
+#include "httpgzipcompression.h"
+#include <QtTest>
+#include <QtEndian>
+#include <zlib.h>
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+/**
+ * @brief Returns reproducible data resembling a text with some binary bytes
+ */
+QByteArray sample(int size) {
+    static const char words[] = "lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor ";
+    QByteArray data;
+    data.reserve(size + 16);
+    quint32 seed = 12345;
+    while (data.size() < size) {
+        seed = seed * 1103515245u + 12345u;
+        int offset = (seed >> 16) % (sizeof(words) - 1);
+        data.append(words + offset, qMin(int(sizeof(words) - 1) - offset, 1 + int(seed >> 28)));
+        data.append(char(seed >> 8));
+        }
+    data.truncate(size);
+    return data;
+}
+
+
+/**
+ * @brief Returns CRC32 computed by zlib
+ */
+quint32 zlibCrc32(const char *data, int size) {
+    return quint32(::crc32(0L, reinterpret_cast<const Bytef *>(data), size));
+}
+
+
+/**
+ * @brief Decompresses gzip stream with zlib
+ *
+ * Incomplete stream is decompressed as far as possible, ok is set to true
+ * only when the whole stream including the trailer is valid.
+ */
+QByteArray gunzip(const QByteArray& gzip, bool *ok) {
+    QByteArray output;
+    *ok = false;
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return output;
+        }
+
+    char buffer[16384];
+    stream.next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(gzip.constData()));
+    stream.avail_in = gzip.size();
+    int rc;
+    do {
+        stream.next_out  = reinterpret_cast<Bytef *>(buffer);
+        stream.avail_out = sizeof(buffer);
+        rc = inflate(&stream, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END) {
+            break;
+            }
+        output.append(buffer, int(sizeof(buffer) - stream.avail_out));
+        } while (rc != Z_STREAM_END);
+
+    *ok = (rc == Z_STREAM_END && stream.avail_in == 0);
+    inflateEnd(&stream);
+    return output;
+}
+#endif
+
+}
+
+
+void Test::gzipCrc32_data() {
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("offset");
+
+    QTest::newRow("empty")          << QByteArray()             << 0;
+    QTest::newRow("check value")    << QByteArray("123456789")  << 0;
+    QTest::newRow("one byte")       << sample(1)                << 0;
+    QTest::newRow("seven bytes")    << sample(7)                << 0;
+    QTest::newRow("eight bytes")    << sample(8)                << 0;
+    QTest::newRow("nine bytes")     << sample(9)                << 0;
+    QTest::newRow("unaligned")      << sample(1000)             << 3;
+    QTest::newRow("all bytes")      << sample(65536 + 7)        << 1;
+}
+
+
+void Test::gzipCrc32() {
+    QFETCH(QByteArray, data);
+    QFETCH(int, offset);
+
+    const char *begin = data.constData() + offset;
+    int size = data.size() - offset;
+    QCOMPARE(HttpGZipCompression::crc32(begin, size), zlibCrc32(begin, size));
+}
+
+
+void Test::gzipCrc32Incremental() {
+    QCOMPARE(HttpGZipCompression::crc32("123456789", 9), quint32(0xcbf43926));
+
+    QByteArray data = sample(10000);
+    quint32 expected = zlibCrc32(data.constData(), data.size());
+    QList<int> splits = QList<int>() << 0 << 1 << 7 << 8 << 13 << 4099 << data.size();
+    for (int i=0; i<splits.size(); i++) {
+        int split = splits[i];
+        quint32 crc = HttpGZipCompression::crc32(data.constData(), split);
+        crc = HttpGZipCompression::crc32(data.constData() + split, data.size() - split, crc);
+        QCOMPARE(crc, expected);
+        }
+}
+
+
+void Test::gzipFraming_data() {
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("level");
+
+    QList<int> levels = QList<int>()
+        << HttpGZipCompression::DefaultCompression
+        << HttpGZipCompression::NoCompression
+        << HttpGZipCompression::BestSpeed
+        << HttpGZipCompression::BestCompression;
+    QList<int> sizes = QList<int>() << 0 << 1 << 1000 << 300000;
+
+    for (int l=0; l<levels.size(); l++) {
+        for (int s=0; s<sizes.size(); s++) {
+            QByteArray tag = QString("level %1, %2 bytes").arg(levels[l]).arg(sizes[s]).toLatin1();
+            QTest::newRow(tag.constData()) << sample(sizes[s]) << levels[l];
+            }
+        }
+}
+
+
+void Test::gzipFraming() {
+    QFETCH(QByteArray, data);
+    QFETCH(int, level);
+
+    QByteArray gzip = HttpGZipCompression::compressData(data, level);
+
+    // RFC 1952: ten bytes of header, deflate data, CRC32 and ISIZE in little endian
+    QVERIFY(gzip.size() >= 18);
+    const uchar *bytes = reinterpret_cast<const uchar *>(gzip.constData());
+    QCOMPARE(int(bytes[0]), 0x1f);
+    QCOMPARE(int(bytes[1]), 0x8b);
+    QCOMPARE(int(bytes[2]), 8);     // CM deflate
+    QCOMPARE(int(bytes[3]), 0);     // FLG, no optional fields
+
+    const uchar *trailer = bytes + gzip.size() - 8;
+    QCOMPARE(qFromLittleEndian<quint32>(trailer), zlibCrc32(data.constData(), data.size()));
+    QCOMPARE(qFromLittleEndian<quint32>(trailer + 4), quint32(data.size()));
+
+    bool ok;
+    QCOMPARE(gunzip(gzip, &ok), data);
+    QVERIFY(ok);
+}
+
+
+void Test::gzipStream() {
+    QByteArray data = sample(200000);
+    HttpGZipStream stream;
+    QByteArray gzip;
+    bool ok;
+
+    // Parts of growing size, every part is flushed and can be decompressed immediately
+    int written = 0;
+    for (int part = 1; written < data.size(); part *= 3) {
+        QByteArray chunk = data.mid(written, part);
+        written += chunk.size();
+        gzip += stream.compress(chunk);
+        QCOMPARE(gunzip(gzip, &ok), data.left(written));
+        QVERIFY(!ok);
+        }
+
+    QVERIFY(!stream.isFinished());
+    gzip += stream.finish();
+    QVERIFY(stream.isFinished());
+    QCOMPARE(gunzip(gzip, &ok), data);
+    QVERIFY(ok);
+    QVERIFY(stream.compress(data).isEmpty());
+}
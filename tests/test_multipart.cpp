@@ -0,0 +1,122 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "test.h"
+#include "httpmultipartparser.h"
+#include <QtTest>
+
+using namespace HobrasoftHttpd;
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+/**
+ * @brief Returns binary content of the uploaded file, it contains an incomplete boundary
+ */
+QByteArray fileContent() {
+    QByteArray content;
+    for (int i=0; i<50000; i++) {
+        content.append(char(i % 251));
+        if (i == 20000) {
+            content.append("\r\n--BOUNDAR");
+            }
+        }
+    return content;
+}
+
+
+QByteArray body() {
+    return QByteArray()
+        + "preamble is ignored\r\n"
+        + "--BOUNDARY\r\n"
+        + "Content-Disposition: form-data; name=\"title\"\r\n"
+        + "\r\n"
+        + "Hello \xc5\xbe world\r\n"
+        + "--BOUNDARY\r\n"
+        + "Content-Disposition: form-data; name=\"tag\"\r\n"
+        + "\r\n"
+        + "one\r\n"
+        + "--BOUNDARY\r\n"
+        + "content-disposition: form-data; name=\"tag\"\r\n"
+        + "\r\n"
+        + "two\r\n"
+        + "--BOUNDARY\r\n"
+        + "Content-Disposition: form-data; name=\"upload\"; filename=\"data.bin\"\r\n"
+        + "Content-Type: application/octet-stream\r\n"
+        + "\r\n"
+        + fileContent() + "\r\n"
+        + "--BOUNDARY\r\n"
+        + "Content-Disposition: form-data; name=\"empty\"; filename=\"empty.txt\"\r\n"
+        + "Content-Type: text/plain\r\n"
+        + "\r\n"
+        + "\r\n"
+        + "--BOUNDARY--\r\n"
+        + "epilogue is ignored\r\n";
+}
+#endif
+
+}
+
+
+void Test::multiPartParser_data() {
+    QTest::addColumn<int>("partSize");
+
+    QTest::newRow("whole body")     << 0;
+    QTest::newRow("bytes")          << 1;
+    QTest::newRow("7 bytes")        << 7;
+    QTest::newRow("boundary size")  << 12;
+    QTest::newRow("4 kB")           << 4096;
+}
+
+
+void Test::multiPartParser() {
+    QFETCH(int, partSize);
+
+    QByteArray data = body();
+    if (partSize <= 0) {
+        partSize = data.size();
+        }
+
+    HttpMultiPartParser parser("BOUNDARY");
+    for (int i=0; i<data.size(); i += partSize) {
+        parser.write(data.constData() + i, qMin(partSize, data.size() - i));
+        }
+    QVERIFY(parser.isFinished());
+
+    QCOMPARE(parser.parameters().value("title"), QString::fromUtf8("Hello \xc5\xbe world"));
+    QStringList tags = parser.parameters().values("tag");
+    tags.sort();
+    QCOMPARE(tags, QStringList() << "one" << "two");
+    QCOMPARE(parser.parameters().value("upload"), QString("data.bin"));
+    QCOMPARE(parser.parameters().value("empty"), QString("empty.txt"));
+    QCOMPARE(parser.contentTypes().value("upload"), QString("application/octet-stream"));
+    QCOMPARE(parser.contentTypes().value("empty"), QString("text/plain"));
+
+    QMap<QString, QTemporaryFile *> files = parser.takeUploadedFiles();
+    QCOMPARE(files.size(), 2);
+    QVERIFY(files.contains("upload"));
+    QVERIFY(files.contains("empty"));
+    QCOMPARE(files["upload"]->readAll(), fileContent());
+    QCOMPARE(files["empty"]->readAll(), QByteArray());
+    qDeleteAll(files);
+
+    QVERIFY(parser.takeUploadedFiles().isEmpty());
+}
+
+
+void Test::multiPartParserIncomplete() {
+    QByteArray data = body();
+    int cut = data.indexOf("\r\n--BOUNDARY\r\nContent-Disposition: form-data; name=\"empty\"");
+    QVERIFY(cut > 0);
+
+    // The file is not complete until the next boundary is found
+    HttpMultiPartParser parser("BOUNDARY");
+    parser.write(data.constData(), cut);
+    QVERIFY(!parser.isFinished());
+    QCOMPARE(parser.parameters().value("title"), QString::fromUtf8("Hello \xc5\xbe world"));
+    QVERIFY(!parser.parameters().contains("upload"));
+    QVERIFY(parser.takeUploadedFiles().isEmpty());
+}
@@ -0,0 +1,92 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "test.h"
+#include "staticfilecontroller.h"
+#include <QtTest>
+#include <QStringList>
+
+using namespace HobrasoftHttpd;
+
+namespace {
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+/**
+ * @brief Returns ranges in the form of the Range header without the unit (0-99,200-299)
+ */
+QString format(const QList<QPair<qint64, qint64> >& ranges) {
+    QStringList list;
+    for (int i=0; i<ranges.size(); i++) {
+        list << QString("%1-%2").arg(ranges[i].first).arg(ranges[i].second);
+        }
+    return list.join(",");
+}
+
+
+/**
+ * @brief Returns count single byte ranges with gaps between them (0-0,2-2,4-4...)
+ */
+QString disjointRanges(int count) {
+    QStringList list;
+    for (int i=0; i<count; i++) {
+        list << QString("%1-%1").arg(2 * i);
+        }
+    return list.join(",");
+}
+#endif
+
+}
+
+
+void Test::parseRanges_data() {
+    QTest::addColumn<QString>("range");
+    QTest::addColumn<qint64>("size");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QString>("ranges");
+
+    QTest::newRow("first bytes")        << "bytes=0-99"             << Q_INT64_C(1000) << true  << "0-99";
+    QTest::newRow("open end")           << "bytes=500-"             << Q_INT64_C(1000) << true  << "500-999";
+    QTest::newRow("suffix")             << "bytes=-100"             << Q_INT64_C(1000) << true  << "900-999";
+    QTest::newRow("long suffix")        << "bytes=-2000"            << Q_INT64_C(1000) << true  << "0-999";
+    QTest::newRow("end after size")     << "bytes=0-5000"           << Q_INT64_C(1000) << true  << "0-999";
+    QTest::newRow("unit case")          << "BYTES=0-9"              << Q_INT64_C(1000) << true  << "0-9";
+    QTest::newRow("spaces")             << "bytes=0-9, 20-29"       << Q_INT64_C(1000) << true  << "0-9,20-29";
+    QTest::newRow("sorted")             << "bytes=200-299,0-99"     << Q_INT64_C(1000) << true  << "0-99,200-299";
+    QTest::newRow("overlapping")        << "bytes=0-99,50-149"      << Q_INT64_C(1000) << true  << "0-149";
+    QTest::newRow("adjacent")           << "bytes=0-99,100-199"     << Q_INT64_C(1000) << true  << "0-199";
+    QTest::newRow("contained")          << "bytes=0-999,10-19,-5"   << Q_INT64_C(1000) << true  << "0-999";
+    QTest::newRow("first and last")     << "bytes=0-0,-1"           << Q_INT64_C(1000) << true  << "0-0,999-999";
+    QTest::newRow("one unsatisfiable")  << "bytes=1000-1100,0-9"    << Q_INT64_C(1000) << true  << "0-9";
+    QTest::newRow("unsatisfiable")      << "bytes=1000-"            << Q_INT64_C(1000) << true  << "";
+    QTest::newRow("empty suffix")       << "bytes=-0"               << Q_INT64_C(1000) << true  << "";
+    QTest::newRow("empty file")         << "bytes=0-"               << Q_INT64_C(0)    << true  << "";
+    QTest::newRow("empty file suffix")  << "bytes=-5"               << Q_INT64_C(0)    << true  << "";
+    QTest::newRow("other unit")         << "items=0-9"              << Q_INT64_C(1000) << false << "";
+    QTest::newRow("no ranges")          << "bytes="                 << Q_INT64_C(1000) << false << "";
+    QTest::newRow("no dash")            << "bytes=10"               << Q_INT64_C(1000) << false << "";
+    QTest::newRow("no numbers")         << "bytes=-"                << Q_INT64_C(1000) << false << "";
+    QTest::newRow("reversed")           << "bytes=9-0"              << Q_INT64_C(1000) << false << "";
+    QTest::newRow("not a number")       << "bytes=a-9"              << Q_INT64_C(1000) << false << "";
+    QTest::newRow("one malformed")      << "bytes=0-9,x"            << Q_INT64_C(1000) << false << "";
+
+    QString sixteen = disjointRanges(16);
+    QTest::newRow("16 ranges")          << "bytes=" + sixteen       << Q_INT64_C(1000) << true  << sixteen;
+    QTest::newRow("17 ranges")          << "bytes=" + disjointRanges(17) << Q_INT64_C(1000) << false << "";
+    QTest::newRow("17 ranges merged")   << "bytes=" + disjointRanges(17) + ",0-40" << Q_INT64_C(1000) << true << "0-40";
+}
+
+
+void Test::parseRanges() {
+    QFETCH(QString, range);
+    QFETCH(qint64, size);
+    QFETCH(bool, valid);
+    QFETCH(QString, ranges);
+
+    bool parsed = !valid;
+    QList<QPair<qint64, qint64> > list = StaticFileController::parseRanges(range, size, &parsed);
+    QCOMPARE(parsed, valid);
+    QCOMPARE(format(list), ranges);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file
+ *
+ * @author Petr Bravenec petr.bravenec@hobrasoft.cz
+ */
+
+#include "test.h"
+#include "httptimerwheel.h"
+#include <QtTest>
+#include <QElapsedTimer>
+
+using namespace HobrasoftHttpd;
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+/**
+ * @brief Records the expiration times of a timer
+ *
+ * Optionally it stops another timer when its own timer expires.
+ */
+class TimerReceiver : public QObject {
+    Q_OBJECT
+  public:
+    TimerReceiver() : other(NULL) { clock.start(); }
+
+    QElapsedTimer       clock;
+    QList<qint64>       expired;
+    HttpTimer          *other;
+
+  public slots:
+    void slotTimeout() {
+        expired << clock.elapsed();
+        if (other != NULL) {
+            other->stop();
+            }
+    }
+};
+#endif
+
+
+void Test::timerWheelExpiry() {
+    TimerReceiver receiver;
+    HttpTimer timer(&receiver, "slotTimeout");
+    QVERIFY(!timer.isActive());
+
+    receiver.clock.start();
+    timer.start(300);
+    QVERIFY(timer.isActive());
+    QCOMPARE(HttpTimerWheel::instance()->count(), 1);
+
+    QTRY_COMPARE_WITH_TIMEOUT(receiver.expired.size(), 1, 2000);
+    QVERIFY(!timer.isActive());
+    QCOMPARE(HttpTimerWheel::instance()->count(), 0);
+
+    // Both clocks count whole milliseconds, the difference can be one millisecond
+    QVERIFY2(receiver.expired[0] >= 300 - 1, qPrintable(QString::number(receiver.expired[0])));
+
+    // Single shot
+    QTest::qWait(600);
+    QCOMPARE(receiver.expired.size(), 1);
+}
+
+
+void Test::timerWheelZero() {
+    TimerReceiver receiver;
+    HttpTimer timer(&receiver, "slotTimeout");
+
+    // The timer expires from the event loop, never inside start()
+    timer.start(0);
+    QVERIFY(receiver.expired.isEmpty());
+    QTRY_COMPARE_WITH_TIMEOUT(receiver.expired.size(), 1, 2000);
+}
+
+
+void Test::timerWheelStop() {
+    TimerReceiver receiver;
+    HttpTimer timer(&receiver, "slotTimeout");
+    timer.start(100);
+    timer.stop();
+    QVERIFY(!timer.isActive());
+    timer.stop();
+
+    // Deleted timer is removed from the wheel
+    HttpTimer *deleted = new HttpTimer(&receiver, "slotTimeout");
+    deleted->start(100);
+    delete deleted;
+
+    QCOMPARE(HttpTimerWheel::instance()->count(), 0);
+    QTest::qWait(600);
+    QVERIFY(receiver.expired.isEmpty());
+}
+
+
+void Test::timerWheelRestart() {
+    TimerReceiver receiver;
+    HttpTimer timer(&receiver, "slotTimeout");
+    receiver.clock.start();
+    timer.start(300);
+    QTest::qWait(200);
+    QVERIFY(receiver.expired.isEmpty());
+
+    // Restarted timer expires once, 300 ms after the restart
+    timer.start(300);
+    QCOMPARE(HttpTimerWheel::instance()->count(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(receiver.expired.size(), 1, 2000);
+    QVERIFY2(receiver.expired[0] >= 500 - 1, qPrintable(QString::number(receiver.expired[0])));
+    QTest::qWait(600);
+    QCOMPARE(receiver.expired.size(), 1);
+}
+
+
+void Test::timerWheelMany() {
+    QList<TimerReceiver *> receivers;
+    QList<HttpTimer *> timers;
+    QList<int> msecs;
+    for (int i=0; i<200; i++) {
+        receivers << new TimerReceiver;
+        timers << new HttpTimer(receivers[i], "slotTimeout");
+        msecs << (i * 37) % 1000;
+        }
+
+    for (int i=0; i<timers.size(); i++) {
+        receivers[i]->clock.start();
+        timers[i]->start(msecs[i]);
+        }
+    QCOMPARE(HttpTimerWheel::instance()->count(), timers.size());
+
+    QTRY_COMPARE_WITH_TIMEOUT(HttpTimerWheel::instance()->count(), 0, 3000);
+    for (int i=0; i<timers.size(); i++) {
+        QCOMPARE(receivers[i]->expired.size(), 1);
+        QVERIFY2(receivers[i]->expired[0] >= msecs[i] - 1, qPrintable(QString("%1 ms timer expired after %2 ms")
+                .arg(msecs[i]).arg(receivers[i]->expired[0])));
+        }
+
+    qDeleteAll(timers);
+    qDeleteAll(receivers);
+}
+
+
+void Test::timerWheelStopFromReceiver() {
+    // Two timers with the same deadline, the first expired one stops the other
+    TimerReceiver receiver1;
+    TimerReceiver receiver2;
+    HttpTimer timer1(&receiver1, "slotTimeout");
+    HttpTimer timer2(&receiver2, "slotTimeout");
+    receiver1.other = &timer2;
+    receiver2.other = &timer1;
+    timer1.start(100);
+    timer2.start(100);
+
+    QTRY_COMPARE_WITH_TIMEOUT(receiver1.expired.size() + receiver2.expired.size(), 1, 2000);
+    QVERIFY(!timer1.isActive());
+    QVERIFY(!timer2.isActive());
+    QCOMPARE(HttpTimerWheel::instance()->count(), 0);
+    QTest::qWait(600);
+    QCOMPARE(receiver1.expired.size() + receiver2.expired.size(), 1);
+}
+
+#include "test_timerwheel.moc"